@@ -0,0 +1,90 @@
+#include "agent.h"
+#include "autopilot.h"
+#include "hamilton_agent.h"
+#include "mcts_agent.h"
+#include "plugin_agent.h"
+#include <stdlib.h>
+#include <string.h>
+
+static int decide_bfs(void *state, const GameState *game) {
+    return bfs_agent_decide((BfsAgent *)state, game);
+}
+
+static void destroy_bfs(void *state) {
+    destroy_bfs_agent((BfsAgent *)state);
+}
+
+static int decide_hamilton(void *state, const GameState *game) {
+    return hamilton_agent_decide((const HamiltonAgent *)state, game);
+}
+
+static void destroy_hamilton(void *state) {
+    destroy_hamilton_agent((HamiltonAgent *)state);
+}
+
+static int decide_mcts(void *state, const GameState *game) {
+    return mcts_agent_decide((MctsAgent *)state, game);
+}
+
+static void destroy_mcts(void *state) {
+    destroy_mcts_agent((MctsAgent *)state);
+}
+
+static int decide_plugin(void *state, const GameState *game) {
+    return plugin_agent_decide((PluginAgent *)state, game);
+}
+
+static void destroy_plugin(void *state) {
+    unload_plugin_agent((PluginAgent *)state);
+}
+
+int create_agent(Agent *agent, const char *name, int width, int height) {
+    memset(agent, 0, sizeof(*agent));
+    if (strcmp(name, "bfs") == 0) {
+        BfsAgent *bfs = (BfsAgent *)malloc(sizeof(BfsAgent));
+        if (!bfs || create_bfs_agent(bfs, width, height) < 0) {
+            free(bfs);
+            return -1;
+        }
+        *agent = (Agent){"bfs", bfs, decide_bfs, destroy_bfs};
+        return 0;
+    }
+    if (strcmp(name, "hamilton") == 0) {
+        HamiltonAgent *hamilton = (HamiltonAgent *)malloc(sizeof(HamiltonAgent));
+        if (!hamilton || create_hamilton_agent(hamilton, width, height) < 0) {
+            free(hamilton);
+            return -1;
+        }
+        *agent = (Agent){"hamilton", hamilton, decide_hamilton, destroy_hamilton};
+        return 0;
+    }
+    if (strcmp(name, "mcts") == 0 || strncmp(name, "mcts:", 5) == 0) {//mcts:<threads> caps the search pool
+        MctsAgent *mcts = (MctsAgent *)malloc(sizeof(MctsAgent));
+        MctsConfig config = default_mcts_config();
+        if (name[4] == ':' && atoi(name + 5) > 0) config.threads = atoi(name + 5);
+        if (!mcts || create_mcts_agent(mcts, width, height, &config) < 0) {
+            free(mcts);
+            return -1;
+        }
+        *agent = (Agent){name, mcts, decide_mcts, destroy_mcts};
+        return 0;
+    }
+    if (strncmp(name, "plugin:", 7) == 0) {
+        PluginAgent *plugin = (PluginAgent *)malloc(sizeof(PluginAgent));
+        if (!plugin || load_plugin_agent(plugin, name + 7, width, height) < 0) {
+            free(plugin);
+            return -1;
+        }
+        *agent = (Agent){name, plugin, decide_plugin, destroy_plugin};
+        return 0;
+    }
+    return -1;
+}
+
+void destroy_agent(Agent *agent) {
+    if (agent->destroy) {
+        agent->destroy(agent->state);
+    }
+    free(agent->state);
+    agent->state = NULL;
+}
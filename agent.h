@@ -0,0 +1,22 @@
+#ifndef AGENT_H
+#define AGENT_H
+
+#include "snake_engine.h"
+
+// A controller that picks a direction each tick, chosen by name so the game
+// and the tools can swap agents from the command line.
+typedef struct {
+    const char *name;
+    void *state;
+    int (*decide)(void *state, const GameState *game);
+    void (*destroy)(void *state);
+} Agent;
+
+int create_agent(Agent *agent, const char *name, int width, int height);
+void destroy_agent(Agent *agent);
+
+static inline int agent_decide(Agent *agent, const GameState *game) {
+    return agent->decide(agent->state, game);
+}
+
+#endif
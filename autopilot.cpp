@@ -0,0 +1,114 @@
+#include "autopilot.h"
+#include "distance_field.h"
+#include <stdlib.h>
+#include <string.h>
+
+int create_bfs_agent(BfsAgent *agent, int width, int height) {
+    int cellCount = width * height;
+    memset(agent, 0, sizeof(*agent));
+    agent->width = width;
+    agent->height = height;
+    agent->queue = (int *)malloc(sizeof(int) * cellCount);
+    agent->firstMove = (unsigned char *)malloc(cellCount);
+    agent->visited = (uint32_t *)calloc(cellCount, sizeof(uint32_t));
+    if (!agent->queue || !agent->firstMove || !agent->visited || create_reachability(&agent->reach, width, height) < 0) {
+        destroy_bfs_agent(agent);
+        return -1;
+    }
+    return 0;
+}
+
+void destroy_bfs_agent(BfsAgent *agent) {
+    free(agent->queue);
+    free(agent->firstMove);
+    free(agent->visited);
+    agent->queue = NULL;
+    agent->firstMove = NULL;
+    agent->visited = NULL;
+    destroy_reachability(&agent->reach);
+}
+
+static void next_generation(BfsAgent *agent) {
+    if (++agent->generation == 0) {//wrapped around, stale stamps could now look fresh
+        memset(agent->visited, 0, sizeof(uint32_t) * agent->width * agent->height);
+        agent->generation = 1;
+    }
+}
+
+// The tail cell counts as free because it moves away on the same tick the head moves
+static int is_blocked(const GameState *game, int cell, int tailCell) {
+    return game->cells[cell] && cell != tailCell;
+}
+
+int bfs_agent_decide(BfsAgent *agent, const GameState *game) {
+    const SnakeGame *snake = &game->snake;
+    Position head = snake_segment(snake, 0);
+    int headCell = cell_index(game, head);
+    int tailCell = cell_index(game, snake_segment(snake, snake->length - 1));
+    int foodCell = game->food.isActive ? cell_index(game, game->food.location) : -1;
+    int current = movement_direction(snake->movement);
+
+    const int *distance = food_distances(game);
+    if (distance) {//the engine keeps the distances current, step downhill without searching
+        int best = -1, bestDistance = DISTANCE_UNREACHABLE;
+        for (int d = 0; d < 4; d++) {
+            Position move = direction_movement(d);
+            if (move.x == -snake->movement.x && move.y == -snake->movement.y) continue;
+            Position q = {head.x + move.x, head.y + move.y};
+            if (check_border_collision(game, q)) continue;
+            int next = cell_index(game, q);
+            if (next == foodCell) return d;
+            if (distance[next] < bestDistance) {
+                best = d;
+                bestDistance = distance[next];
+            }
+        }
+        if (best >= 0) return best;
+    }
+
+    next_generation(agent);
+    agent->visited[headCell] = agent->generation;
+    int qHead = 0, qTail = 0;
+    for (int d = 0; d < 4; d++) {
+        Position move = direction_movement(d);
+        if (move.x == -snake->movement.x && move.y == -snake->movement.y) continue;//steer_snake would ignore a reversal
+        Position q = {head.x + move.x, head.y + move.y};
+        if (check_border_collision(game, q)) continue;
+        int next = cell_index(game, q);
+        if (is_blocked(game, next, tailCell)) continue;
+        if (next == foodCell) return d;
+        agent->visited[next] = agent->generation;
+        agent->firstMove[next] = (unsigned char)d;
+        agent->queue[qTail++] = next;
+    }
+    int safeMoves = qTail;
+
+    while (qHead < qTail) {
+        int cell = agent->queue[qHead++];
+        Position p = {cell % game->width, cell / game->width};
+        for (int d = 0; d < 4; d++) {
+            Position move = direction_movement(d);
+            Position q = {p.x + move.x, p.y + move.y};
+            if (check_border_collision(game, q)) continue;
+            int next = cell_index(game, q);
+            if (agent->visited[next] == agent->generation || is_blocked(game, next, tailCell)) continue;
+            if (next == foodCell) return agent->firstMove[cell];
+            agent->visited[next] = agent->generation;
+            agent->firstMove[next] = agent->firstMove[cell];
+            agent->queue[qTail++] = next;
+        }
+    }
+
+    // No path to the food: take the safe move with the most room, keeping the heading on ties.
+    // The tracker answers each move from its union-find instead of a flood fill per move.
+    int best = current, bestArea = -1;
+    for (int i = 0; i < safeMoves; i++) {
+        int d = agent->firstMove[agent->queue[i]];
+        int area = reachable_after_move(&agent->reach, game, d);
+        if (area > bestArea || (area == bestArea && d == current)) {
+            best = d;
+            bestArea = area;
+        }
+    }
+    return best;
+}
@@ -0,0 +1,22 @@
+#ifndef AUTOPILOT_H
+#define AUTOPILOT_H
+
+#include "snake_engine.h"
+#include "reachability.h"
+
+// Breadth-first path-to-food agent. All search buffers are sized for the
+// board once in create_bfs_agent() and reused on every decision.
+typedef struct {
+    int width, height;
+    int *queue;             // cell indices waiting to be expanded
+    unsigned char *firstMove;   // direction of the first step on the path to each cell
+    uint32_t *visited;      // cell was reached in the search tagged with this generation
+    uint32_t generation;
+    ReachabilityTracker reach;  // room after each safe move once the food is cut off
+} BfsAgent;
+
+int create_bfs_agent(BfsAgent *agent, int width, int height);
+void destroy_bfs_agent(BfsAgent *agent);
+int bfs_agent_decide(BfsAgent *agent, const GameState *game);
+
+#endif
@@ -0,0 +1,141 @@
+#include "batch_runner.h"
+#include "observation.h"
+#include "distance_field.h"
+#include <stdlib.h>
+#include <string.h>
+
+static void group_range(const BatchRunner *runner, int group, int *first, int *count) {
+    int half = runner->pipelined ? runner->envCount / 2 : runner->envCount;
+    *first = group ? half : 0;
+    *count = group ? runner->envCount - half : half;
+}
+
+// Applies the actions of one group, steps it and encodes its next observations
+static void advance_group(BatchRunner *runner, int group) {
+    int first, count;
+    group_range(runner, group, &first, &count);
+    for (int i = first; i < first + count; i++) {
+        GameState *game = &runner->games[i];
+        int score = game->score;
+        steer_snake(&game->snake, direction_movement(runner->actions[i]));
+        step_game(game);
+        runner->rewards[i] = (float)(game->score - score);
+        runner->dones[i] = (unsigned char)game->isGameOver;
+        if (game->isGameOver) {
+            initialize_game(game);
+            runner->episodes++;
+        }
+        encode_observation(game, runner->observations + (size_t)i * runner->observationSize);
+    }
+    runner->steps += count;
+}
+
+static void run_policy(BatchRunner *runner, int group) {
+    int first, count;
+    group_range(runner, group, &first, &count);
+    if (count > 0) {
+        runner->policy(runner->user, runner->observations + (size_t)first * runner->observationSize, count, runner->observationSize, runner->actions + first);
+    }
+}
+
+static int encoder_main(void *data) {
+    BatchRunner *runner = (BatchRunner *)data;
+    while (1) {
+        SDL_SemWait(runner->encoderWork);
+        if (runner->stopping) {
+            return 0;
+        }
+        advance_group(runner, runner->encoderGroup);
+        SDL_SemPost(runner->encoderDone);
+    }
+}
+
+int create_batch_runner(BatchRunner *runner, int envCount, int width, int height, uint32_t seed, BatchPolicyFunction policy, void *user, int pipelined) {
+    memset(runner, 0, sizeof(*runner));
+    runner->envCount = envCount;
+    runner->width = width;
+    runner->height = height;
+    runner->observationSize = observation_size(width, height);
+    runner->policy = policy;
+    runner->user = user;
+    runner->pipelined = pipelined && envCount > 1;
+    runner->games = (GameState *)calloc(envCount, sizeof(GameState));
+    runner->fields = (DistanceField *)calloc(envCount, sizeof(DistanceField));
+    runner->observations = (float *)malloc(sizeof(float) * runner->observationSize * envCount);
+    runner->actions = (int *)calloc(envCount, sizeof(int));
+    runner->rewards = (float *)calloc(envCount, sizeof(float));
+    runner->dones = (unsigned char *)calloc(envCount, 1);
+    if (!runner->games || !runner->fields || !runner->observations || !runner->actions || !runner->rewards || !runner->dones) {
+        destroy_batch_runner(runner);
+        return -1;
+    }
+    for (int i = 0; i < envCount; i++) {
+        if (create_game(&runner->games[i], width, height, seed + (uint32_t)i) < 0 || create_distance_field(&runner->fields[i], width, height) < 0) {
+            destroy_batch_runner(runner);
+            return -1;
+        }
+        runner->games[i].distanceField = &runner->fields[i];
+        initialize_game(&runner->games[i]);
+        encode_observation(&runner->games[i], runner->observations + (size_t)i * runner->observationSize);
+    }
+    if (runner->pipelined) {
+        runner->encoderWork = SDL_CreateSemaphore(0);
+        runner->encoderDone = SDL_CreateSemaphore(0);
+        runner->encoder = runner->encoderWork && runner->encoderDone ? SDL_CreateThread(encoder_main, "batch encoder", runner) : NULL;
+        if (!runner->encoder) {
+            destroy_batch_runner(runner);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+void destroy_batch_runner(BatchRunner *runner) {
+    if (runner->encoder) {
+        runner->stopping = 1;
+        SDL_SemPost(runner->encoderWork);
+        SDL_WaitThread(runner->encoder, NULL);
+    }
+    if (runner->encoderWork) SDL_DestroySemaphore(runner->encoderWork);
+    if (runner->encoderDone) SDL_DestroySemaphore(runner->encoderDone);
+    for (int i = 0; runner->games && i < runner->envCount; i++) {
+        destroy_game(&runner->games[i]);
+    }
+    for (int i = 0; runner->fields && i < runner->envCount; i++) {
+        destroy_distance_field(&runner->fields[i]);
+    }
+    free(runner->games);
+    free(runner->fields);
+    free(runner->observations);
+    free(runner->actions);
+    free(runner->rewards);
+    free(runner->dones);
+    memset(runner, 0, sizeof(*runner));
+}
+
+static void start_encoder(BatchRunner *runner, int group) {
+    runner->encoderGroup = group;
+    SDL_SemPost(runner->encoderWork);
+}
+
+void run_batch_ticks(BatchRunner *runner, int ticks) {
+    if (!runner->pipelined) {
+        for (int t = 0; t < ticks; t++) {
+            run_policy(runner, 0);
+            advance_group(runner, 0);
+        }
+        return;
+    }
+    // Half 1 is always one policy call behind half 0: its step and encode
+    // run on the encoder thread while the policy works on half 0, and the
+    // other way round
+    for (int t = 0; t < ticks; t++) {
+        if (t > 0) start_encoder(runner, 1);
+        run_policy(runner, 0);
+        if (t > 0) SDL_SemWait(runner->encoderDone);
+        start_encoder(runner, 0);
+        run_policy(runner, 1);
+        SDL_SemWait(runner->encoderDone);
+    }
+    if (ticks > 0) advance_group(runner, 1);
+}
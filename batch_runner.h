@@ -0,0 +1,37 @@
+#ifndef BATCH_RUNNER_H
+#define BATCH_RUNNER_H
+
+#include <SDL2/SDL.h>
+#include "snake_engine.h"
+
+// Steps many games under one policy that is called on whole batches of
+// observations instead of once per game. Finished games restart on their
+// own. In pipelined mode the games are split into two halves: while the
+// policy runs on one half, an encoder thread applies the previous actions
+// of the other half, steps it and encodes its next observations.
+
+typedef void (*BatchPolicyFunction)(void *user, const float *observations, int count, int observationSize, int *actions);
+
+typedef struct {
+    int envCount, width, height, observationSize;
+    GameState *games;
+    struct DistanceField *fields;   // one per game, feeds the food distance plane
+    float *observations;    // envCount * observationSize, contiguous in game order
+    int *actions;
+    float *rewards;         // score gained by each game on its latest tick
+    unsigned char *dones;   // game ended on its latest tick and was restarted
+    BatchPolicyFunction policy;
+    void *user;
+    int pipelined;
+    SDL_Thread *encoder;
+    SDL_sem *encoderWork, *encoderDone;
+    int encoderGroup;
+    int stopping;
+    long steps, episodes;
+} BatchRunner;
+
+int create_batch_runner(BatchRunner *runner, int envCount, int width, int height, uint32_t seed, BatchPolicyFunction policy, void *user, int pipelined);
+void destroy_batch_runner(BatchRunner *runner);
+void run_batch_ticks(BatchRunner *runner, int ticks);
+
+#endif
@@ -0,0 +1,37 @@
+#ifndef BYTE_ORDER_H
+#define BYTE_ORDER_H
+
+#include <stdint.h>
+
+// Little-endian field access for the on-disk formats, whatever the host order
+
+static inline void put_u16(unsigned char *out, uint32_t value) {
+    out[0] = (unsigned char)value;
+    out[1] = (unsigned char)(value >> 8);
+}
+
+static inline void put_u32(unsigned char *out, uint32_t value) {
+    out[0] = (unsigned char)value;
+    out[1] = (unsigned char)(value >> 8);
+    out[2] = (unsigned char)(value >> 16);
+    out[3] = (unsigned char)(value >> 24);
+}
+
+static inline void put_u64(unsigned char *out, uint64_t value) {
+    put_u32(out, (uint32_t)value);
+    put_u32(out + 4, (uint32_t)(value >> 32));
+}
+
+static inline uint32_t get_u16(const unsigned char *in) {
+    return in[0] | (uint32_t)in[1] << 8;
+}
+
+static inline uint32_t get_u32(const unsigned char *in) {
+    return in[0] | (uint32_t)in[1] << 8 | (uint32_t)in[2] << 16 | (uint32_t)in[3] << 24;
+}
+
+static inline uint64_t get_u64(const unsigned char *in) {
+    return get_u32(in) | (uint64_t)get_u32(in + 4) << 32;
+}
+
+#endif
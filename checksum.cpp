@@ -0,0 +1,25 @@
+#include "checksum.h"
+
+typedef struct {
+    uint32_t entries[256];
+} CrcTable;
+
+static CrcTable make_crc_table(void) {
+    CrcTable table;
+    for (uint32_t i = 0; i < 256; i++) {
+        uint32_t crc = i;
+        for (int bit = 0; bit < 8; bit++) crc = crc >> 1 ^ (0xedb88320u & (0u - (crc & 1)));
+        table.entries[i] = crc;
+    }
+    return table;
+}
+
+// A byte per table lookup; save files checksum megabytes at a time
+uint32_t crc32(const unsigned char *data, size_t size) {
+    static const CrcTable table = make_crc_table();//built on first use, thread-safe
+    uint32_t crc = 0xffffffffu;
+    for (size_t i = 0; i < size; i++) {
+        crc = crc >> 8 ^ table.entries[(crc ^ data[i]) & 0xff];
+    }
+    return ~crc;
+}
@@ -0,0 +1,10 @@
+#ifndef CHECKSUM_H
+#define CHECKSUM_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// CRC-32 (IEEE, as in zip and PNG) guarding the on-disk records
+uint32_t crc32(const unsigned char *data, size_t size);
+
+#endif
@@ -0,0 +1,70 @@
+#include <SDL2/SDL.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "snake_engine.h"
+#include "replay.h"
+#include "replay_corpus.h"
+
+// Replay corpora for training pipelines, see replay_corpus.h.
+// Usage: corpus build <corpus> <file or directory>...   index goes to <corpus>.idx
+//        corpus scan <corpus>                            plays every game back, reports throughput
+
+static int build(const char *corpusPath, const char *indexPath, int argc, char *argv[]) {
+    ReplayPathList list = {};
+    for (int i = 0; i < argc; i++) {
+        if (add_replay_path(&list, argv[i]) < 0) {
+            printf("Out of memory\n");
+            return 1;
+        }
+    }
+    long skipped = 0;
+    int result = build_replay_corpus(corpusPath, indexPath, list.paths, list.count, &skipped);
+    if (result < 0) {
+        printf("Cannot write %s or %s\n", corpusPath, indexPath);
+    } else {
+        printf("%ld replays written, %ld unreadable skipped\n", list.count - skipped, skipped);
+    }
+    free_replay_paths(&list);
+    return result < 0;
+}
+
+static int scan(const char *corpusPath, const char *indexPath) {
+    ReplayCorpus corpus;
+    if (open_replay_corpus(&corpus, corpusPath, indexPath) < 0) {
+        printf("Cannot open corpus %s with index %s\n", corpusPath, indexPath);
+        return 1;
+    }
+    CorpusCursor cursor;
+    open_corpus_cursor(&cursor, &corpus);
+    uint64_t ticks = 0, games = 0;
+    long scoreCheck = 0;
+    Uint64 start = SDL_GetPerformanceCounter();
+    while (corpus_next_game(&cursor) == 0) {
+        while (corpus_step(&cursor) >= 0) ticks++;
+        scoreCheck += cursor.game.score != cursor.reader.header.score;
+        games++;
+    }
+    double seconds = (double)(SDL_GetPerformanceCounter() - start) / (double)SDL_GetPerformanceFrequency();
+    printf("%llu of %llu games, %llu transitions, %.1f MB in %.3f s: %.0f transitions/s, %.1f MB/s, %ld results differ from the claim\n",
+           (unsigned long long)games, (unsigned long long)corpus.count, (unsigned long long)ticks, corpus.corpus.size / 1e6, seconds,
+           ticks / seconds, corpus.corpus.size / 1e6 / seconds, scoreCheck);
+    close_corpus_cursor(&cursor);
+    close_replay_corpus(&corpus);
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+    if (argc >= 3) {
+        char indexPath[1024];
+        snprintf(indexPath, sizeof(indexPath), "%s.idx", argv[2]);
+        if (strcmp(argv[1], "build") == 0) {
+            return build(argv[2], indexPath, argc - 3, argv + 3);
+        } else if (strcmp(argv[1], "scan") == 0) {
+            return scan(argv[2], indexPath);
+        }
+    }
+    printf("Usage: %s build <corpus> <file or directory>...\n", argv[0]);
+    printf("       %s scan <corpus>\n", argv[0]);
+    return 1;
+}
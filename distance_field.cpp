@@ -0,0 +1,203 @@
+#include "distance_field.h"
+#include <stdlib.h>
+#include <string.h>
+
+int create_distance_field(DistanceField *field, int width, int height) {
+    int cellCount = width * height;
+    memset(field, 0, sizeof(*field));
+    field->width = width;
+    field->height = height;
+    field->distance = (int *)malloc(sizeof(int) * cellCount);
+    field->queue = (int *)malloc(sizeof(int) * cellCount);
+    field->affected = (int *)malloc(sizeof(int) * cellCount);
+    field->seeds = (uint64_t *)malloc(sizeof(uint64_t) * cellCount);
+    field->seen = (uint32_t *)calloc(cellCount, sizeof(uint32_t));
+    field->isAffected = (uint32_t *)calloc(cellCount, sizeof(uint32_t));
+    if (!field->distance || !field->queue || !field->affected || !field->seeds || !field->seen || !field->isAffected) {
+        destroy_distance_field(field);
+        return -1;
+    }
+    for (int i = 0; i < cellCount; i++) {
+        field->distance[i] = DISTANCE_UNREACHABLE;
+    }
+    return 0;
+}
+
+void destroy_distance_field(DistanceField *field) {
+    free(field->distance);
+    free(field->queue);
+    free(field->affected);
+    free(field->seeds);
+    free(field->seen);
+    free(field->isAffected);
+    field->distance = NULL;
+    field->queue = NULL;
+    field->affected = NULL;
+    field->seeds = NULL;
+    field->seen = NULL;
+    field->isAffected = NULL;
+}
+
+// The field must have been created for the game's board size
+void attach_distance_field(GameState *game, DistanceField *field) {
+    game->distanceField = field;
+    if (field) {
+        rebuild_distance_field(field, game);
+    }
+}
+
+static void next_generation(DistanceField *field) {
+    if (++field->generation == 0) {//wrapped around, stale stamps could now look fresh
+        memset(field->seen, 0, sizeof(uint32_t) * field->width * field->height);
+        memset(field->isAffected, 0, sizeof(uint32_t) * field->width * field->height);
+        field->generation = 1;
+    }
+}
+
+// Free cells next to cell, returns how many were written to neighbours
+static int free_neighbours(const GameState *game, int cell, int neighbours[4]) {
+    Position p = {cell % game->width, cell / game->width};
+    int count = 0;
+    for (int d = 0; d < 4; d++) {
+        Position move = direction_movement(d);
+        Position q = {p.x + move.x, p.y + move.y};
+        if (check_border_collision(game, q) || game->cells[cell_index(game, q)]) continue;
+        neighbours[count++] = cell_index(game, q);
+    }
+    return count;
+}
+
+// Breadth-first from the food over every free cell
+void rebuild_distance_field(DistanceField *field, const GameState *game) {
+    int cellCount = field->width * field->height;
+    for (int i = 0; i < cellCount; i++) {
+        field->distance[i] = DISTANCE_UNREACHABLE;
+    }
+    field->rebuilds++;
+    if (!game->food.isActive || check_self_collision(game, game->food.location)) {
+        return;
+    }
+    int head = 0, tail = 0;
+    int food = cell_index(game, game->food.location);
+    field->distance[food] = 0;
+    field->queue[tail++] = food;
+    while (head < tail) {
+        int cell = field->queue[head++];
+        int neighbours[4];
+        int count = free_neighbours(game, cell, neighbours);
+        for (int i = 0; i < count; i++) {
+            if (field->distance[neighbours[i]] != DISTANCE_UNREACHABLE) continue;
+            field->distance[neighbours[i]] = field->distance[cell] + 1;
+            field->queue[tail++] = neighbours[i];
+        }
+    }
+}
+
+// A freed cell can only shorten paths, and only through itself, so a
+// breadth-first relaxation outwards from it is enough
+void distance_field_cell_freed(DistanceField *field, const GameState *game, int cell) {
+    int neighbours[4];
+    int count = free_neighbours(game, cell, neighbours);
+    int best = DISTANCE_UNREACHABLE;
+    for (int i = 0; i < count; i++) {
+        if (field->distance[neighbours[i]] + 1 < best) best = field->distance[neighbours[i]] + 1;
+    }
+    field->patches++;
+    field->distance[cell] = best;
+    if (best == DISTANCE_UNREACHABLE) {
+        return;
+    }
+    int head = 0, tail = 0;
+    field->queue[tail++] = cell;
+    while (head < tail) {
+        int current = field->queue[head++];
+        count = free_neighbours(game, current, neighbours);
+        for (int i = 0; i < count; i++) {
+            if (field->distance[neighbours[i]] <= field->distance[current] + 1) continue;
+            field->distance[neighbours[i]] = field->distance[current] + 1;
+            field->queue[tail++] = neighbours[i];
+        }
+    }
+}
+
+// Seeds are sorted as (distance << 32 | cell) so no context is needed
+static int compare_seed(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+    return x < y ? -1 : x > y;
+}
+
+// A taken cell can only lengthen paths. Cells that lost their last neighbour
+// one step closer to the food are found level by level, then those cells alone
+// are re-solved from the unaffected cells around them.
+void distance_field_cell_taken(DistanceField *field, const GameState *game, int cell) {
+    int old = field->distance[cell];
+    field->distance[cell] = DISTANCE_UNREACHABLE;
+    field->patches++;
+    if (old == DISTANCE_UNREACHABLE) {
+        return;
+    }
+    next_generation(field);
+    uint32_t generation = field->generation;
+    int neighbours[4], count;
+    int head = 0, tail = 0, affectedCount = 0;
+    count = free_neighbours(game, cell, neighbours);
+    for (int i = 0; i < count; i++) {
+        if (field->distance[neighbours[i]] != old + 1) continue;
+        field->seen[neighbours[i]] = generation;
+        field->queue[tail++] = neighbours[i];
+    }
+    // Levels come off the queue in increasing order, so every possible support
+    // of a cell has been decided by the time the cell itself is checked
+    while (head < tail) {
+        int current = field->queue[head++];
+        int level = field->distance[current];
+        int supported = 0;
+        count = free_neighbours(game, current, neighbours);
+        for (int i = 0; i < count && !supported; i++) {
+            supported = field->distance[neighbours[i]] == level - 1 && field->isAffected[neighbours[i]] != generation;
+        }
+        if (supported) continue;
+        field->isAffected[current] = generation;
+        field->affected[affectedCount++] = current;
+        for (int i = 0; i < count; i++) {
+            if (field->distance[neighbours[i]] != level + 1 || field->seen[neighbours[i]] == generation) continue;
+            field->seen[neighbours[i]] = generation;
+            field->queue[tail++] = neighbours[i];
+        }
+    }
+    if (affectedCount == 0) {
+        return;
+    }
+
+    // Best distance through an unaffected neighbour, then a unit-weight
+    // Dijkstra: merge the sorted seeds with a FIFO of relaxed cells
+    for (int i = 0; i < affectedCount; i++) {
+        int best = DISTANCE_UNREACHABLE;
+        count = free_neighbours(game, field->affected[i], neighbours);
+        for (int j = 0; j < count; j++) {
+            if (field->isAffected[neighbours[j]] == generation) continue;
+            if (field->distance[neighbours[j]] + 1 < best) best = field->distance[neighbours[j]] + 1;
+        }
+        field->distance[field->affected[i]] = best;
+        field->seeds[i] = (uint64_t)best << 32 | (uint32_t)field->affected[i];
+    }
+    qsort(field->seeds, affectedCount, sizeof(uint64_t), compare_seed);
+    int seed = 0;
+    head = tail = 0;
+    while (seed < affectedCount || head < tail) {
+        int current;
+        if (head == tail || (seed < affectedCount && (int)(field->seeds[seed] >> 32) <= field->distance[field->queue[head]])) {
+            current = (int)(field->seeds[seed++] & 0xffffffffu);
+        } else {
+            current = field->queue[head++];
+        }
+        if (field->distance[current] == DISTANCE_UNREACHABLE) break;//everything left is cut off from the food
+        count = free_neighbours(game, current, neighbours);
+        for (int i = 0; i < count; i++) {
+            int next = neighbours[i];
+            if (field->isAffected[next] != generation || field->distance[next] <= field->distance[current] + 1) continue;
+            field->distance[next] = field->distance[current] + 1;
+            field->queue[tail++] = next;
+        }
+    }
+}
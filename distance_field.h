@@ -0,0 +1,37 @@
+#ifndef DISTANCE_FIELD_H
+#define DISTANCE_FIELD_H
+
+#include <stddef.h>
+#include "snake_engine.h"
+
+#define DISTANCE_UNREACHABLE 0x3fffffff
+
+// Shortest-path distance from every free cell to the regular food, around
+// the snake. Attached to a game it is rebuilt when the food moves and
+// patched by step_game() as the tail frees a cell and the head takes one,
+// so agents and the observation encoder can read it instead of searching.
+typedef struct DistanceField {
+    int width, height;
+    int *distance;      // steps to the food, DISTANCE_UNREACHABLE for snake cells and walled-off regions
+    int *queue;
+    int *affected;      // cells whose distance grew when the head took a cell
+    uint64_t *seeds;    // their new distances, sorted before re-solving
+    uint32_t *seen;     // queued while patching, stamped with generation
+    uint32_t *isAffected;
+    uint32_t generation;
+    long rebuilds, patches;
+} DistanceField;
+
+int create_distance_field(DistanceField *field, int width, int height);
+void destroy_distance_field(DistanceField *field);
+void attach_distance_field(GameState *game, DistanceField *field);
+void rebuild_distance_field(DistanceField *field, const GameState *game);
+void distance_field_cell_freed(DistanceField *field, const GameState *game, int cell);
+void distance_field_cell_taken(DistanceField *field, const GameState *game, int cell);
+
+// Read-only view for agents; NULL when the game has no field attached
+static inline const int *food_distances(const GameState *game) {
+    return game->distanceField ? game->distanceField->distance : NULL;
+}
+
+#endif
@@ -0,0 +1,53 @@
+#include <stdio.h>
+#include <string.h>
+
+// Writes the given asset files into a header as constant byte arrays so the
+// game can be built with -DEMBED_ASSETS and started without any asset files.
+// Usage: embed_assets <output.h> <asset> [asset...]
+int main(int argc, char *argv[]) {
+    if (argc < 3) {
+        printf("Usage: %s <output.h> <asset> [asset...]\n", argv[0]);
+        return 1;
+    }
+
+    FILE *out = fopen(argv[1], "w");
+    if (!out) {
+        printf("Cannot open %s for writing\n", argv[1]);
+        return 1;
+    }
+
+    fprintf(out, "// Generated by embed_assets. Do not edit.\n");
+    fprintf(out, "#include <stddef.h>\n\n");
+    fprintf(out, "typedef struct {\n    const char *name;\n    const unsigned char *data;\n    size_t size;\n} EmbeddedAsset;\n\n");
+
+    for (int i = 2; i < argc; i++) {
+        FILE *in = fopen(argv[i], "rb");
+        if (!in) {
+            printf("Cannot open asset %s\n", argv[i]);
+            fclose(out);
+            return 1;
+        }
+        fprintf(out, "static const unsigned char embedded_asset_%d[] = {", i - 2);
+        unsigned char buffer[4096];
+        size_t count, total = 0;
+        while ((count = fread(buffer, 1, sizeof(buffer), in)) > 0) {
+            for (size_t j = 0; j < count; j++, total++) {
+                fprintf(out, "%s0x%02x,", total % 16 == 0 ? "\n    " : " ", buffer[j]);
+            }
+        }
+        fprintf(out, "\n};\n\n");
+        fclose(in);
+    }
+
+    fprintf(out, "static const EmbeddedAsset embeddedAssets[] = {\n");
+    for (int i = 2; i < argc; i++) {
+        // Assets are looked up by the same relative path main() passes to the loaders
+        const char *name = strrchr(argv[i], '/');
+        name = name ? name + 1 : argv[i];
+        fprintf(out, "    {\"%s\", embedded_asset_%d, sizeof(embedded_asset_%d)},\n", name, i - 2, i - 2);
+    }
+    fprintf(out, "};\n\n#define EMBEDDED_ASSET_COUNT %d\n", argc - 2);
+
+    fclose(out);
+    return 0;
+}
@@ -0,0 +1,44 @@
+/*
+ * Minimal plugin for snake_agent_api.h: heads for the food, never into a
+ * wall or the body when another move exists. Build it as a shared library
+ * (see the Makefile's plugin target) and run the game with
+ * --autopilot plugin:./example_agent_plugin.dll
+ */
+#include <stdlib.h>
+#include "snake_agent_api.h"
+
+SNAKE_AGENT_EXPORT int32_t snake_agent_api_version(void) {
+    return SNAKE_AGENT_API_VERSION;
+}
+
+SNAKE_AGENT_EXPORT void *snake_agent_create(int32_t width, int32_t height) {
+    (void)width;
+    (void)height;
+    static int instance;
+    return &instance;
+}
+
+SNAKE_AGENT_EXPORT int32_t snake_agent_act(void *agent, const SnakeAgentView *view) {
+    static const SnakeAgentPosition moves[4] = {{0, -1}, {0, 1}, {-1, 0}, {1, 0}};
+    SnakeAgentPosition head = view->body[view->bodyHead];
+    int32_t best = -1, bestDistance = 0;
+    (void)agent;
+    for (int32_t d = 0; d < 4; d++) {
+        int32_t x = head.x + moves[d].x, y = head.y + moves[d].y;
+        if (moves[d].x == -view->movement.x && moves[d].y == -view->movement.y) continue;
+        if (x < 0 || x >= view->width || y < 0 || y >= view->height || view->cells[y * view->width + x]) continue;
+        int32_t distance = abs(x - view->food.x) + abs(y - view->food.y);
+        if (best < 0 || distance < bestDistance) {
+            best = d;
+            bestDistance = distance;
+        }
+    }
+    if (best >= 0) return best;
+    if (view->movement.y < 0) return SNAKE_AGENT_UP;
+    if (view->movement.y > 0) return SNAKE_AGENT_DOWN;
+    return view->movement.x < 0 ? SNAKE_AGENT_LEFT : SNAKE_AGENT_RIGHT;
+}
+
+SNAKE_AGENT_EXPORT void snake_agent_destroy(void *agent) {
+    (void)agent;
+}
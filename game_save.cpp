@@ -0,0 +1,193 @@
+#include "game_save.h"
+#include "checksum.h"
+#include "replay.h"
+#include "byte_order.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+static_assert(sizeof(SaveRecord) == SAVE_RECORD_SIZE, "SaveRecord is the on-disk layout");
+static_assert(sizeof(Position) == 8, "segments are stored as Position");
+
+size_t saved_game_size(const GameState *game) {
+    return SAVE_RECORD_SIZE + sizeof(Position) * game->snake.length;
+}
+
+// Writes saved_game_size() bytes, 4-byte aligned in a save file
+void write_saved_game(const GameState *game, unsigned char *out) {
+    SaveRecord record = {};
+    record.size = (uint32_t)saved_game_size(game);
+    record.rulesVersion = RULES_VERSION;
+    record.width = (uint32_t)game->width;
+    record.height = (uint32_t)game->height;
+    record.foodPoints = game->rules.foodPoints;
+    record.bonusPoints = game->rules.bonusPoints;
+    record.poisonEnabled = game->rules.poisonEnabled;
+    record.poisonPenalty = game->rules.poisonPenalty;
+    record.poisonLifetime = game->rules.poisonLifetime;
+    record.foodX = game->food.location.x;
+    record.foodY = game->food.location.y;
+    record.foodActive = game->food.isActive;
+    record.bonusX = game->bonus.location.x;
+    record.bonusY = game->bonus.location.y;
+    record.bonusActive = game->bonus.isActive;
+    record.poisonX = game->poison.location.x;
+    record.poisonY = game->poison.location.y;
+    record.poisonActive = game->poison.isActive;
+    record.poisonSpawnTick = game->poison.spawnTick;
+    record.score = game->score;
+    record.speed = game->speed;
+    record.foodConsumed = game->foodConsumed;
+    record.isGameOver = game->isGameOver;
+    record.endReason = game->endReason;
+    record.tick = game->tick;
+    record.rng = game->rng;
+    record.movementX = game->snake.movement.x;
+    record.movementY = game->snake.movement.y;
+    record.length = (uint32_t)game->snake.length;
+    memcpy(out, &record, SAVE_RECORD_SIZE);
+    const SnakeGame *snake = &game->snake;
+    int first = snake->capacity - snake->head < snake->length ? snake->capacity - snake->head : snake->length;
+    memcpy(out + SAVE_RECORD_SIZE, snake->body + snake->head, sizeof(Position) * first);//the ring buffer in at most two pieces
+    memcpy(out + SAVE_RECORD_SIZE + sizeof(Position) * first, snake->body, sizeof(Position) * (snake->length - first));
+    put_u32(out, crc32(out + 4, record.size - 4));
+}
+
+// The board a saved game needs, so the caller can create a game for it
+int saved_game_board(const unsigned char *data, size_t size, int *width, int *height) {
+    if (size < SAVE_RECORD_SIZE) {
+        return -1;
+    }
+    SaveRecord record;
+    memcpy(&record, data, SAVE_RECORD_SIZE);
+    if (record.width < 2 || record.height < 1 || record.width > MAX_BOARD_CELLS / record.height) {//create_game() would refuse it
+        return -1;
+    }
+    *width = (int)record.width;
+    *height = (int)record.height;
+    return 0;
+}
+
+static int on_board(const GameState *game, int x, int y) {
+    return x >= 0 && y >= 0 && x < game->width && y < game->height;
+}
+
+// Loads one saved game into game, created for the same board, and sets used
+// to the bytes it took; data must be 4-byte aligned, as every record in a
+// buffer from load_games() is. The checksum only catches accidents, so every
+// field is checked before game is touched against what a game played under
+// a named rules variant could reach, with check_snapshot() for the state.
+int read_saved_game(GameState *game, const unsigned char *data, size_t size, size_t *used) {
+    SaveRecord record;
+    if (size < SAVE_RECORD_SIZE || (uintptr_t)data % alignof(Position) != 0) {
+        return -1;
+    }
+    memcpy(&record, data, SAVE_RECORD_SIZE);
+    if (record.width != (uint32_t)game->width || record.height != (uint32_t)game->height || record.rulesVersion != RULES_VERSION
+        || record.length < 1 || record.length > (uint32_t)(game->width * game->height)
+        || record.size != SAVE_RECORD_SIZE + sizeof(Position) * record.length || record.size > size
+        || crc32(data + 4, record.size - 4) != record.crc) {
+        return -1;
+    }
+    Position movement = direction_movement(movement_direction((Position){record.movementX, record.movementY}));
+    if (movement.x != record.movementX || movement.y != record.movementY || !on_board(game, record.foodX, record.foodY)
+        || !on_board(game, record.bonusX, record.bonusY) || !on_board(game, record.poisonX, record.poisonY)) {
+        return -1;
+    }
+    GameRules rules = {record.foodPoints, record.bonusPoints, record.poisonEnabled, record.poisonPenalty, record.poisonLifetime};
+    if (!rules_name(&rules)) {
+        return -1;
+    }
+    GameSnapshot snapshot = {};
+    snapshot.segments = (Position *)(data + SAVE_RECORD_SIZE);//restore_snapshot() only reads them
+    GameState *state = &snapshot.state;
+    state->width = game->width;
+    state->height = game->height;
+    state->rules = rules;
+    state->snake.capacity = game->width * game->height;
+    state->snake.length = (int)record.length;
+    state->snake.movement = (Position){record.movementX, record.movementY};
+    state->food = (RegularFood){{record.foodX, record.foodY}, record.foodActive != 0};
+    state->bonus = (BonusFood){{record.bonusX, record.bonusY}, record.bonusActive != 0};
+    state->poison = (PoisonFood){{record.poisonX, record.poisonY}, record.poisonActive != 0, record.poisonSpawnTick};
+    state->score = record.score;
+    state->speed = record.speed;
+    state->foodConsumed = record.foodConsumed;
+    state->isGameOver = record.isGameOver != 0;
+    state->endReason = record.endReason;
+    state->tick = record.tick;
+    state->rng = record.rng;
+    unsigned char *scratch = (unsigned char *)calloc((size_t)game->width * game->height, 1);//game->cells is still the live game's
+    int valid = scratch && check_snapshot(&snapshot, scratch);
+    free(scratch);
+    if (!valid) {
+        return -1;
+    }
+    restore_snapshot(game, &snapshot);
+    *used = record.size;
+    return 0;
+}
+
+// Writes every game with a single write to a temporary file, then renames it
+// over path so a crash leaves the previous save whole
+int save_games(const char *path, const GameState *games, int count) {
+    size_t size = SAVE_HEADER_SIZE;
+    for (int i = 0; i < count; i++) size += saved_game_size(&games[i]);
+    unsigned char *bytes = (unsigned char *)malloc(size);
+    if (!bytes) {
+        return -1;
+    }
+    memcpy(bytes, "SNSV", 4);
+    put_u32(bytes + 4, SAVE_FORMAT_VERSION);
+    put_u32(bytes + 8, (uint32_t)count);
+    put_u32(bytes + 12, 0);
+    size_t offset = SAVE_HEADER_SIZE;
+    for (int i = 0; i < count; i++) {
+        write_saved_game(&games[i], bytes + offset);
+        offset += saved_game_size(&games[i]);
+    }
+    char temporary[512];
+    snprintf(temporary, sizeof(temporary), "%s.tmp", path);
+    FILE *file = fopen(temporary, "wb");
+    int ok = file && fwrite(bytes, 1, size, file) == size;
+    if (file) ok = fclose(file) == 0 && ok;
+    free(bytes);
+#ifdef _WIN32
+    ok = ok && MoveFileExA(temporary, path, MOVEFILE_REPLACE_EXISTING);
+#else
+    ok = ok && rename(temporary, path) == 0;
+#endif
+    if (!ok) remove(temporary);
+    return ok ? 0 : -1;
+}
+
+// Reads a whole save file in one go and checks its header; the games start
+// SAVE_HEADER_SIZE bytes in, read_saved_game() each in turn
+int load_games(const char *path, unsigned char **data, size_t *size, uint32_t *count) {
+    if (load_file(path, data, size) < 0) {
+        return -1;
+    }
+    if (*size < SAVE_HEADER_SIZE || memcmp(*data, "SNSV", 4) != 0 || get_u32(*data + 4) != SAVE_FORMAT_VERSION) {
+        free(*data);
+        *data = NULL;
+        return -1;
+    }
+    *count = get_u32(*data + 8);
+    return 0;
+}
+
+// The first game of a save file
+int load_game(const char *path, GameState *game) {
+    unsigned char *data;
+    size_t size, used;
+    uint32_t count;
+    if (load_games(path, &data, &size, &count) < 0) {
+        return -1;
+    }
+    int result = count ? read_saved_game(game, data + SAVE_HEADER_SIZE, size - SAVE_HEADER_SIZE, &used) : -1;
+    free(data);
+    return result;
+}
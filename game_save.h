@@ -0,0 +1,55 @@
+#ifndef GAME_SAVE_H
+#define GAME_SAVE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "snake_engine.h"
+
+// Suspended games: the complete state, food timers and PRNG included, so a
+// loaded game plays on exactly as it would have. A file holds any number of
+// games for checkpointing many at once.
+//
+// File layout, little-endian: "SNSV" | u32 format version | u32 game count |
+// u32 reserved, then per game a SaveRecord followed by the snake's segments
+// from the head as i32 x, y pairs. Every record starts with a CRC-32 of the
+// rest of it, segments included.
+//
+// All record fields are 32-bit and the segments match Position, so a
+// little-endian host loads a game with two copies once it is validated.
+
+#define SAVE_FORMAT_VERSION 1
+#define SAVE_HEADER_SIZE 16
+#define SAVE_RECORD_SIZE 128
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+#error "game_save.cpp copies little-endian records as they are"
+#endif
+
+typedef struct {
+    uint32_t crc;
+    uint32_t size;                  // this record and its segments
+    uint32_t rulesVersion;
+    uint32_t width, height;
+    int32_t foodPoints, bonusPoints, poisonEnabled, poisonPenalty, poisonLifetime;
+    int32_t foodX, foodY, foodActive;
+    int32_t bonusX, bonusY, bonusActive;
+    int32_t poisonX, poisonY, poisonActive;
+    uint32_t poisonSpawnTick;
+    int32_t score, speed, foodConsumed;
+    int32_t isGameOver, endReason;
+    uint32_t tick, rng;
+    int32_t movementX, movementY;
+    uint32_t length;
+    uint32_t reserved[2];
+} SaveRecord;
+
+size_t saved_game_size(const GameState *game);
+void write_saved_game(const GameState *game, unsigned char *out);
+int saved_game_board(const unsigned char *data, size_t size, int *width, int *height);
+int read_saved_game(GameState *game, const unsigned char *data, size_t size, size_t *used);
+
+int save_games(const char *path, const GameState *games, int count);
+int load_games(const char *path, unsigned char **data, size_t *size, uint32_t *count);
+int load_game(const char *path, GameState *game);
+
+#endif
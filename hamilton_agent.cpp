@@ -0,0 +1,90 @@
+#include "hamilton_agent.h"
+#include <stdlib.h>
+
+// Cells kept free between the new head and the tail when cutting, so food
+// eaten on the shortcut (the tail then stays put for a tick) cannot close the gap
+#define SHORTCUT_MARGIN 3
+
+int create_hamilton_agent(HamiltonAgent *agent, int width, int height) {
+    agent->cycleIndex = NULL;
+    if ((width % 2 && height % 2) || width < 2 || height < 2) {
+        return -1;//odd by odd boards have no Hamiltonian cycle
+    }
+    agent->width = width;
+    agent->height = height;
+    agent->cellCount = width * height;
+    agent->cycleIndex = (int *)malloc(sizeof(int) * agent->cellCount);
+    if (!agent->cycleIndex) {
+        return -1;
+    }
+
+    // Along the first row, zig-zag back through the remaining rows leaving
+    // the first column free, then up the first column. Needs an even number
+    // of rows, so boards with an odd height use the transposed layout.
+    int transposed = height % 2;
+    int rows = transposed ? width : height, columns = transposed ? height : width;
+    int index = 0;
+    for (int c = 0; c < columns; c++) {
+        int cell = transposed ? c * width : c;
+        agent->cycleIndex[cell] = index++;
+    }
+    for (int r = 1; r < rows; r++) {
+        for (int i = 1; i < columns; i++) {
+            int c = r % 2 ? columns - i : i;
+            int cell = transposed ? c * width + r : r * width + c;
+            agent->cycleIndex[cell] = index++;
+        }
+    }
+    for (int r = rows - 1; r >= 1; r--) {
+        int cell = transposed ? r : r * width;
+        agent->cycleIndex[cell] = index++;
+    }
+    if (transposed) {//run it the other way round so the starting snake already lies along it, heading right
+        for (int i = 0; i < agent->cellCount; i++) {
+            agent->cycleIndex[i] = agent->cellCount - 1 - agent->cycleIndex[i];
+        }
+    }
+    return 0;
+}
+
+void destroy_hamilton_agent(HamiltonAgent *agent) {
+    free(agent->cycleIndex);
+    agent->cycleIndex = NULL;
+}
+
+static int cycle_distance(const HamiltonAgent *agent, int from, int to) {
+    int distance = agent->cycleIndex[to] - agent->cycleIndex[from];
+    return distance < 0 ? distance + agent->cellCount : distance;
+}
+
+int hamilton_agent_decide(const HamiltonAgent *agent, const GameState *game) {
+    const SnakeGame *snake = &game->snake;
+    Position head = snake_segment(snake, 0);
+    int headCell = cell_index(game, head);
+    int tailCell = cell_index(game, snake_segment(snake, snake->length - 1));
+    int tailDistance = cycle_distance(agent, headCell, tailCell);
+    int foodDistance = game->food.isActive ? cycle_distance(agent, headCell, cell_index(game, game->food.location)) : agent->cellCount;
+
+    // Every move lands strictly between the head and the tail in cycle order,
+    // so the body stays sorted along the cycle and the cell after the head is
+    // always free (or the tail, which is leaving). Past half the board the
+    // gaps shortcuts leave behind cost more than they save, so only follow the cycle.
+    int maxJump = snake->length * 2 < agent->cellCount ? tailDistance - SHORTCUT_MARGIN : 1;
+    if (foodDistance < maxJump) maxJump = foodDistance;
+    if (maxJump < 1) maxJump = 1;
+
+    int best = movement_direction(snake->movement), bestJump = 0;
+    for (int d = 0; d < 4; d++) {
+        Position move = direction_movement(d);
+        if (move.x == -snake->movement.x && move.y == -snake->movement.y) continue;
+        Position q = {head.x + move.x, head.y + move.y};
+        if (check_border_collision(game, q)) continue;
+        int next = cell_index(game, q);
+        int jump = cycle_distance(agent, headCell, next);
+        if (jump > bestJump && jump <= maxJump && (!game->cells[next] || next == tailCell)) {
+            best = d;
+            bestJump = jump;
+        }
+    }
+    return best;
+}
@@ -0,0 +1,18 @@
+#ifndef HAMILTON_AGENT_H
+#define HAMILTON_AGENT_H
+
+#include "snake_engine.h"
+
+// Follows a precomputed Hamiltonian cycle of the board, which fills it
+// completely, and cuts across the cycle towards the food while the snake
+// is short enough that the shortcut provably cannot trap it.
+typedef struct {
+    int width, height, cellCount;
+    int *cycleIndex;    // position of each cell along the cycle
+} HamiltonAgent;
+
+int create_hamilton_agent(HamiltonAgent *agent, int width, int height);
+void destroy_hamilton_agent(HamiltonAgent *agent);
+int hamilton_agent_decide(const HamiltonAgent *agent, const GameState *game);
+
+#endif
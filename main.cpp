@@ -4,196 +4,601 @@
 #include <SDL2/SDL_mixer.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 #include <time.h>
+#include "snake_engine.h"
+#include "agent.h"
+#include "distance_field.h"
+#include "replay.h"
+#include "replay_codec.h"
+#include "score_log.h"
+#include "replay_spool.h"
+#include "game_save.h"
+
+#ifdef EMBED_ASSETS
+#include "embedded_assets.h" // generated by embed_assets, see Makefile
+#endif
 
 #define SCREEN_WIDTH 700
 #define SCREEN_HEIGHT 600
 #define BLOCK_DIMENSION 20
-#define INITIAL_SPEED 200
+
+#define FIRST_GLYPH ' '
+#define LAST_GLYPH '~'
+#define GLYPH_ATLAS_WIDTH 512
+#define MAX_TEXT_LENGTH 64
 
 typedef struct {
-    int x, y;
-} Position;
+    SDL_Rect source;    // where the glyph sits in the atlas texture, empty for blank glyphs
+    int advance;
+} Glyph;
 
 typedef struct {
-    Position body[SCREEN_WIDTH * SCREEN_HEIGHT / (BLOCK_DIMENSION * BLOCK_DIMENSION)];
-    int length;
-    Position movement;
-} SnakeGame;
+    SDL_Texture *texture;
+    int textureSize;
+    Glyph glyphs[LAST_GLYPH - FIRST_GLYPH + 1];
+} GlyphAtlas;
+
+#define MAX_STARTUP_PHASES 32
 
 typedef struct {
-    Position location;
-    int isActive;
-} RegularFood;
+    const char *name;
+    const char *asset; // file the phase loads, NULL for subsystem phases
+    Uint64 start, end;
+} StartupPhase;
 
 typedef struct {
-    Position location;
-    int isActive;
-} BonusFood;
+    StartupPhase phases[MAX_STARTUP_PHASES];
+    int count;
+    Uint64 origin;
+} StartupProfile;
+
+int profile_begin(StartupProfile *profile, const char *name, const char *asset) {//SDL_GetPerformanceCounter works before SDL_Init
+    if (profile->count == MAX_STARTUP_PHASES) {
+        return -1;
+    }
+    StartupPhase *phase = &profile->phases[profile->count];
+    phase->name = name;
+    phase->asset = asset;
+    phase->start = SDL_GetPerformanceCounter();
+    phase->end = phase->start;
+    return profile->count++;
+}
 
-SDL_Texture *load_asset(SDL_Renderer *renderer, const char *filePath) {//optimised image format for rendering
-    SDL_Surface *image = IMG_Load(filePath);
+void profile_end(StartupProfile *profile, int phase) {
+    if (phase >= 0) {
+        profile->phases[phase].end = SDL_GetPerformanceCounter();
+    }
+}
+
+void write_startup_profile(const StartupProfile *profile, Uint64 firstFrame, FILE *out) {
+    fprintf(out, "{\"frequency\": %llu, \"first_frame_ticks\": %llu, \"phases\": [",
+            (unsigned long long)SDL_GetPerformanceFrequency(), (unsigned long long)(firstFrame - profile->origin));
+    for (int i = 0; i < profile->count; i++) {
+        const StartupPhase *phase = &profile->phases[i];
+        fprintf(out, "%s\n  {\"name\": \"%s\"", i ? "," : "", phase->name);
+        if (phase->asset) {
+            fprintf(out, ", \"asset\": \"%s\"", phase->asset);
+        }
+        fprintf(out, ", \"start_ticks\": %llu, \"ticks\": %llu}",
+                (unsigned long long)(phase->start - profile->origin), (unsigned long long)(phase->end - phase->start));
+    }
+    fprintf(out, "\n]}\n");
+}
+
+SDL_RWops *open_asset(const char *filePath) {//assets come from the executable itself in EMBED_ASSETS builds
+#ifdef EMBED_ASSETS
+    for (int i = 0; i < EMBEDDED_ASSET_COUNT; i++) {
+        if (strcmp(embeddedAssets[i].name, filePath) == 0) {
+            return SDL_RWFromConstMem(embeddedAssets[i].data, (int)embeddedAssets[i].size);
+        }
+    }
+    printf("Asset not embedded: %s\n", filePath);
+    return NULL;
+#else
+    return SDL_RWFromFile(filePath, "rb");
+#endif
+}
+
+Uint32 native_texture_format(SDL_Renderer *renderer) {//the format the driver stores textures in, so uploads need no conversion
+    SDL_RendererInfo info;
+    if (SDL_GetRendererInfo(renderer, &info) == 0) {
+        for (Uint32 i = 0; i < info.num_texture_formats; i++) {
+            Uint32 format = info.texture_formats[i];
+            if (!SDL_ISPIXELFORMAT_FOURCC(format) && SDL_ISPIXELFORMAT_ALPHA(format)) {
+                return format;
+            }
+        }
+        for (Uint32 i = 0; i < info.num_texture_formats; i++) {
+            if (!SDL_ISPIXELFORMAT_FOURCC(info.texture_formats[i])) {
+                return info.texture_formats[i];
+            }
+        }
+    }
+    return SDL_PIXELFORMAT_ARGB8888;
+}
+
+SDL_Texture *surface_to_texture(SDL_Renderer *renderer, Uint32 textureFormat, SDL_Surface *surface) {
+    // 24-bit JPGs and palettized PNGs are converted once here instead of on every upload
+    SDL_Surface *converted = SDL_ConvertSurfaceFormat(surface, textureFormat, 0);
+    if (!converted) {
+        printf("Image conversion failed: %s\n", SDL_GetError());
+        return NULL;
+    }
+    SDL_Texture *texture = SDL_CreateTexture(renderer, textureFormat, SDL_TEXTUREACCESS_STATIC, converted->w, converted->h);
+    if (texture) {
+        SDL_UpdateTexture(texture, NULL, converted->pixels, converted->pitch);
+        if (SDL_ISPIXELFORMAT_ALPHA(textureFormat)) {
+            SDL_SetTextureBlendMode(texture, SDL_BLENDMODE_BLEND);
+        }
+    }
+    SDL_FreeSurface(converted);
+    return texture;
+}
+
+SDL_Texture *load_asset(SDL_Renderer *renderer, Uint32 textureFormat, const char *filePath) {//optimised image format for rendering
+    SDL_Surface *image = IMG_Load_RW(open_asset(filePath), 1);
     if (!image) {
         printf("Image load failed: %s\n", IMG_GetError());
         return NULL;
     }
-    SDL_Texture *texture = SDL_CreateTextureFromSurface(renderer, image);
+    SDL_Texture *texture = surface_to_texture(renderer, textureFormat, image);
     SDL_FreeSurface(image);
     return texture;
 }
 
-void display_text(SDL_Renderer *renderer, TTF_Font *font, const char *message, SDL_Color textColor, int x, int y) {
-    SDL_Surface *textSurface = TTF_RenderText_Solid(font, message, textColor);
-    SDL_Texture *textTexture = SDL_CreateTextureFromSurface(renderer, textSurface);
-    SDL_Rect renderQuad = {x, y, textSurface->w, textSurface->h};
-    SDL_RenderCopy(renderer, textTexture, NULL, &renderQuad);
-    SDL_FreeSurface(textSurface);
-    SDL_DestroyTexture(textTexture);
+int bake_glyph_atlas(GlyphAtlas *atlas, SDL_Renderer *renderer, Uint32 textureFormat, TTF_Font *font) {//rasterize the printable ASCII glyphs once, in white so any color can be applied per vertex
+    SDL_Surface *sheet = SDL_CreateRGBSurfaceWithFormat(0, GLYPH_ATLAS_WIDTH, GLYPH_ATLAS_WIDTH, 32, SDL_PIXELFORMAT_ARGB8888);
+    if (!sheet) {
+        return -1;
+    }
+    SDL_FillRect(sheet, NULL, SDL_MapRGBA(sheet->format, 0, 0, 0, 0));
+    int x = 0, y = 0, rowHeight = 0;
+    for (int c = FIRST_GLYPH; c <= LAST_GLYPH; c++) {
+        Glyph *glyph = &atlas->glyphs[c - FIRST_GLYPH];
+        int minx, maxx, miny, maxy;
+        TTF_GlyphMetrics(font, (Uint16)c, &minx, &maxx, &miny, &maxy, &glyph->advance);
+        glyph->source = (SDL_Rect){0, 0, 0, 0};
+        SDL_Surface *rendered = TTF_RenderGlyph_Solid(font, (Uint16)c, (SDL_Color){255, 255, 255, 255});
+        if (!rendered) {
+            continue;//space and missing glyphs only advance the pen
+        }
+        SDL_Surface *glyphSurface = SDL_ConvertSurfaceFormat(rendered, SDL_PIXELFORMAT_ARGB8888, 0);
+        SDL_FreeSurface(rendered);
+        if (!glyphSurface) {
+            continue;
+        }
+        if (x + glyphSurface->w > GLYPH_ATLAS_WIDTH) {
+            x = 0;
+            y += rowHeight + 1;
+            rowHeight = 0;
+        }
+        glyph->source = (SDL_Rect){x, y, glyphSurface->w, glyphSurface->h};
+        SDL_SetSurfaceBlendMode(glyphSurface, SDL_BLENDMODE_NONE);
+        SDL_BlitSurface(glyphSurface, NULL, sheet, &glyph->source);
+        x += glyphSurface->w + 1;
+        if (glyphSurface->h > rowHeight) rowHeight = glyphSurface->h;
+        SDL_FreeSurface(glyphSurface);
+    }
+    atlas->texture = surface_to_texture(renderer, textureFormat, sheet);
+    atlas->textureSize = GLYPH_ATLAS_WIDTH;
+    SDL_FreeSurface(sheet);
+    return atlas->texture ? 0 : -1;
 }
 
-void initialize_game(SnakeGame *snake, RegularFood *food, BonusFood *bonus, int *score, int *speed, int *foodConsumed) {
-    snake->length = 2;
-    snake->movement = (Position){1, 0};
-    for (int i = 0; i < snake->length; i++) {
-        snake->body[i] = (Position){snake->length - i - 1, 0}; //(1,0),(0,0)
-    }
-    food->location = (Position){rand() % (SCREEN_WIDTH / BLOCK_DIMENSION), rand() % (SCREEN_HEIGHT / BLOCK_DIMENSION)};
-    food->isActive = 1;
-    bonus->isActive = 0; 
-    *score = 0;
-    *speed = INITIAL_SPEED;
-    *foodConsumed = 0;
+void display_text(SDL_Renderer *renderer, const GlyphAtlas *atlas, const char *message, SDL_Color textColor, int x, int y) {//one textured quad per glyph, all drawn by a single geometry call
+    SDL_Vertex vertices[MAX_TEXT_LENGTH * 4];
+    int indices[MAX_TEXT_LENGTH * 6];
+    int quads = 0;
+    float scale = 1.0f / atlas->textureSize;
+    for (const char *c = message; *c && quads < MAX_TEXT_LENGTH; c++) {
+        if (*c < FIRST_GLYPH || *c > LAST_GLYPH) {
+            continue;
+        }
+        const Glyph *glyph = &atlas->glyphs[*c - FIRST_GLYPH];
+        if (glyph->source.w > 0) {
+            const SDL_Rect *src = &glyph->source;
+            float left = (float)x, top = (float)y, right = left + src->w, bottom = top + src->h;
+            float u0 = src->x * scale, v0 = src->y * scale, u1 = (src->x + src->w) * scale, v1 = (src->y + src->h) * scale;
+            SDL_Vertex *v = &vertices[quads * 4];
+            v[0] = (SDL_Vertex){{left, top}, textColor, {u0, v0}};
+            v[1] = (SDL_Vertex){{right, top}, textColor, {u1, v0}};
+            v[2] = (SDL_Vertex){{right, bottom}, textColor, {u1, v1}};
+            v[3] = (SDL_Vertex){{left, bottom}, textColor, {u0, v1}};
+            int *index = &indices[quads * 6];
+            index[0] = quads * 4; index[1] = quads * 4 + 1; index[2] = quads * 4 + 2;
+            index[3] = quads * 4; index[4] = quads * 4 + 2; index[5] = quads * 4 + 3;
+            quads++;
+        }
+        x += glyph->advance;
+    }
+    if (quads > 0) {
+        SDL_RenderGeometry(renderer, atlas->texture, vertices, quads * 4, indices, quads * 6);
+    }
 }
 
-int check_self_collision(SnakeGame *snake) {
-    for (int i = 1; i < snake->length; i++) {
-        if (snake->body[0].x == snake->body[i].x && snake->body[0].y == snake->body[i].y) {//matha baad jabe
-            return 1;
-        }
+// One tick: a replay or the autopilot steers when given, and the recorder logs the heading taken
+int advance_game(GameState *game, Agent *autopilot, const ReplayReader *replay, ReplayWriter *recorder) {
+    if (replay) {
+        steer_snake(&game->snake, direction_movement(replay_action(replay->actions, game->tick)));
+    } else if (autopilot) {
+        steer_snake(&game->snake, direction_movement(agent_decide(autopilot, game)));
     }
-    return 0;
+    if (recorder) {
+        record_replay_tick(recorder, game);
+    }
+    return step_game(game);
 }
 
-int check_border_collision(SnakeGame *snake) {
-    if (snake->body[0].x < 0 || snake->body[0].x >= SCREEN_WIDTH / BLOCK_DIMENSION || snake->body[0].y < 0 || snake->body[0].y >= SCREEN_HEIGHT / BLOCK_DIMENSION) {
-        return 1;
+// Returns the replay's hash for the score log, 0 when it could not be written.
+// With a spool the replay is only queued and the writer thread does the I/O.
+// Compressed replays are hashed as their plain image, which expanding restores.
+uint64_t save_recording(ReplayWriter *recorder, const GameState *game, const char *prefix, int *count, ReplaySpool *spool, int compress) {
+    uint64_t hash = 0;
+    if (spool) {
+        end_replay(recorder, game);
+        if (spool_replay(spool, recorder, &hash) < 0) printf("Out of memory queueing a replay\n");
+        return hash;
     }
-    return 0;
+    char path[512];
+    snprintf(path, sizeof(path), "%s-%d.%s", prefix, (*count)++, compress ? "snz" : "snr");
+    end_replay(recorder, game);
+    size_t size = encoded_replay_size(recorder);
+    unsigned char *bytes = (unsigned char *)malloc(size);
+    unsigned char *stored = bytes;
+    size_t storedSize = size;
+    if (bytes) {
+        encode_replay(recorder, bytes);
+        if (compress && compress_replay(bytes, size, &stored, &storedSize) < 0) stored = NULL;
+    }
+    FILE *file = stored ? fopen(path, "wb") : NULL;
+    if (file) {
+        int ok = fwrite(stored, 1, storedSize, file) == storedSize;
+        if (fclose(file) == 0 && ok) hash = replay_hash(bytes, size);
+    }
+    if (!hash) {
+        printf("Cannot write replay %s\n", path);
+    }
+    if (stored != bytes) free(stored);
+    free(bytes);
+    return hash;
 }
 
-void update_snake(SnakeGame *snake) {
-    for (int i = snake->length - 1; i > 0; i--) {
-        snake->body[i] = snake->body[i - 1];//pichoner segment gula ager segmment k follow korbe
+void record_score(ScoreLog *scores, const GameState *game, uint32_t seed, uint64_t replayHash) {
+    ScoreRecord record = {game->score, game->snake.length, seed, (uint64_t)time(NULL), replayHash};
+    if (append_score(scores, &record) < 0 || sync_score_log(scores) < 0) {
+        printf("Cannot write to %s\n", scores->logPath);
     }
-    snake->body[0].x += snake->movement.x;//shamner segment agaite thakbe
-    snake->body[0].y += snake->movement.y;
 }
 
-int spawn_new_food(RegularFood *food, BonusFood *bonus, SnakeGame *snake, int *foodConsumed) {
-    while (1) {
-        food->location.x = rand() % (SCREEN_WIDTH / BLOCK_DIMENSION);//normal food
-        food->location.y = rand() % (SCREEN_HEIGHT / BLOCK_DIMENSION);
-        if (!check_self_collision(snake)) {
-            break;
-        }
+int run_headless(GameState *game, Agent *autopilot, const ReplayReader *replay, ReplayWriter *recorder, long maxTicks) {//pure simulation, no window, audio device or font is ever opened
+    while (!game->isGameOver && (long)game->tick < maxTicks && (!replay || game->tick < replay->header.ticks)) {
+        advance_game(game, autopilot, replay, recorder);
     }
-    
-    if (*foodConsumed >= 5) {
-        bonus->location = (Position){rand() % (SCREEN_WIDTH / BLOCK_DIMENSION), rand() % (SCREEN_HEIGHT / BLOCK_DIMENSION)};//bonus food
-        bonus->isActive = 1;
-        *foodConsumed = 0;
+    printf("ticks=%u score=%d length=%d gameover=%d\n", game->tick, game->score, game->snake.length, game->isGameOver);
+    if (replay && (game->score != replay->header.score || game->snake.length != replay->header.length)) {
+        printf("replay claims score=%d length=%d\n", replay->header.score, replay->header.length);
+        return 1;
     }
-    
     return 0;
 }
 
 int main(int argc, char *argv[]) {
-    if (SDL_Init(SDL_INIT_VIDEO | SDL_INIT_AUDIO) < 0 || TTF_Init() == -1 || Mix_OpenAudio(44100, MIX_DEFAULT_FORMAT, 2, 2048) < 0) {
+    StartupProfile startup = {};
+    startup.origin = SDL_GetPerformanceCounter();
+    const char *profilePath = NULL;//--profile-startup [file] prints per-phase timings as JSON, to stdout without a file
+    int profileStartup = 0;
+    int headless = 0, mute = 0;//--headless skips video, audio and fonts, --mute skips only audio
+    const char *autopilotName = NULL;//--autopilot [bfs|hamilton|mcts[:threads]|plugin:<library>] lets an agent steer, for attract mode and headless baselines
+    int boardWidth = SCREEN_WIDTH / BLOCK_DIMENSION, boardHeight = SCREEN_HEIGHT / BLOCK_DIMENSION;
+    long maxTicks = 1000000;
+    uint32_t seed = (uint32_t)time(NULL);
+    GameRules rules = classic_rules();//--rules poison plays the task_302 variant with poisonous food
+    const char *recordPrefix = NULL;//--record <prefix> saves every game as <prefix>-<n>.snr
+    int spoolPolicy = -1;//--async drop|block|spill records on a writer thread into <prefix>-<n>.snc corpus segments instead
+    int compressReplays = 0;//--compress saves recordings run-length and range coded as <prefix>-<n>.snz
+    const char *replayPath = NULL;//--replay <file> plays a recorded game back instead of taking input, compressed or not
+    uint32_t keyframeInterval = 0;//--keyframes <ticks> stores the full state that often in recordings, for seeking
+    long seekTick = 0;//--seek <tick> starts a replay at that tick
+    const char *savePath = "snake.sav";//F5 saves the game here and F9 loads it
+    int loadSave = 0;//--load <file> resumes a saved game, which also decides the board and rules, and F5/F9 use that file
+    const char *scoresPath = NULL;//--scores <base> keeps finished games in <base>.log and <base>.snap, "highscores" when playing in a window
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--profile-startup") == 0) {
+            profileStartup = 1;
+            if (i + 1 < argc && argv[i + 1][0] != '-') profilePath = argv[++i];
+        } else if (strcmp(argv[i], "--headless") == 0) {
+            headless = 1;
+        } else if (strcmp(argv[i], "--mute") == 0) {
+            mute = 1;
+        } else if (strcmp(argv[i], "--ticks") == 0 && i + 1 < argc) {
+            maxTicks = atol(argv[++i]);
+        } else if (strcmp(argv[i], "--autopilot") == 0) {
+            autopilotName = i + 1 < argc && argv[i + 1][0] != '-' ? argv[++i] : "bfs";
+        } else if (strcmp(argv[i], "--board") == 0 && i + 1 < argc) {//headless only, the window is sized for the default board
+            sscanf(argv[++i], "%dx%d", &boardWidth, &boardHeight);
+        } else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+            seed = (uint32_t)strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--rules") == 0 && i + 1 < argc) {
+            if (find_rules(argv[++i], &rules) < 0) {
+                printf("Unknown rules: %s\n", argv[i]);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--record") == 0 && i + 1 < argc) {
+            recordPrefix = argv[++i];
+        } else if (strcmp(argv[i], "--compress") == 0) {
+            compressReplays = 1;
+        } else if (strcmp(argv[i], "--replay") == 0 && i + 1 < argc) {
+            replayPath = argv[++i];
+        } else if (strcmp(argv[i], "--keyframes") == 0 && i + 1 < argc) {
+            keyframeInterval = (uint32_t)strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--seek") == 0 && i + 1 < argc) {
+            seekTick = atol(argv[++i]);
+        } else if (strcmp(argv[i], "--async") == 0 && i + 1 < argc) {
+            if (find_spool_policy(argv[++i], &spoolPolicy) < 0) {
+                printf("Unknown backpressure policy: %s\n", argv[i]);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--load") == 0 && i + 1 < argc) {
+            savePath = argv[++i];
+            loadSave = 1;
+        } else if (strcmp(argv[i], "--scores") == 0 && i + 1 < argc) {
+            scoresPath = argv[++i];
+        }
+    }
+
+    if (compressReplays && spoolPolicy >= 0) {//corpus segments hold plain replays so they can be read in place
+        printf("--compress cannot be combined with --async\n");
+        return 1;
+    }
+    if (!headless) {
+        boardWidth = SCREEN_WIDTH / BLOCK_DIMENSION;
+        boardHeight = SCREEN_HEIGHT / BLOCK_DIMENSION;
+    }
+    unsigned char *replayData = NULL;
+    size_t replaySize = 0;
+    ReplayReader replay;
+    if (replayPath) {//the replay decides the board, rules and seed
+        if (load_replay_file(replayPath, &replayData, &replaySize) < 0 || open_replay(&replay, replayData, replaySize) < 0) {
+            printf("Cannot read replay %s\n", replayPath);
+            return 1;
+        }
+        if (replay.header.rulesVersion != RULES_VERSION || (!headless && (replay.header.width != boardWidth || replay.header.height != boardHeight))) {
+            printf("Replay needs rules version %d on a %dx%d board\n", replay.header.rulesVersion, replay.header.width, replay.header.height);
+            return 1;
+        }
+        boardWidth = replay.header.width;
+        boardHeight = replay.header.height;
+        rules = replay.header.rules;
+        seed = replay.header.seed;
+        autopilotName = NULL;
+        recordPrefix = NULL;
+        scoresPath = NULL;
+    } else if (!scoresPath && !headless) {
+        scoresPath = "highscores";
+    }
+    unsigned char *saveData = NULL;
+    size_t saveSize = 0;
+    if (loadSave) {//the save decides the board and rules, a recording could not reproduce it
+        uint32_t savedGames = 0;
+        int savedWidth = 0, savedHeight = 0;
+        if (replayPath || recordPrefix) {
+            printf("A loaded game cannot be replayed or recorded\n");
+            return 1;
+        }
+        if (load_games(savePath, &saveData, &saveSize, &savedGames) < 0 || savedGames == 0
+            || saved_game_board(saveData + SAVE_HEADER_SIZE, saveSize - SAVE_HEADER_SIZE, &savedWidth, &savedHeight) < 0) {
+            printf("Cannot read saved game %s\n", savePath);
+            return 1;
+        }
+        if (!headless && (savedWidth != boardWidth || savedHeight != boardHeight)) {
+            printf("Saved game is for a %dx%d board\n", savedWidth, savedHeight);
+            return 1;
+        }
+        boardWidth = savedWidth;
+        boardHeight = savedHeight;
+    }
+    GameState game;//SNAKE, FOOD, SCORE, SPEED
+    Agent autopilot = {};
+    if (create_game(&game, boardWidth, boardHeight, seed) < 0) {
+        return 1;
+    }
+    game.rules = rules;
+    if (autopilotName && create_agent(&autopilot, autopilotName, boardWidth, boardHeight) < 0) {
+        printf("Unknown autopilot or unsupported board: %s\n", autopilotName);
+        return 1;
+    }
+    DistanceField foodDistance = {};
+    if (autopilotName) {//agents read food distances from the engine instead of searching every tick
+        if (create_distance_field(&foodDistance, boardWidth, boardHeight) < 0) {
+            return 1;
+        }
+        game.distanceField = &foodDistance;
+    }
+    ReplayWriter recorder = {};
+    int recordedGames = 0;
+    if (recordPrefix && begin_replay(&recorder, &game, keyframeInterval) < 0) {
+        return 1;
+    }
+    ReplaySpool spoolStorage;
+    ReplaySpool *spool = NULL;
+    if (recordPrefix && spoolPolicy >= 0) {//4 MB absorbs hundreds of games, segments rotate at 64 MB
+        if (open_replay_spool(&spoolStorage, recordPrefix, 4 << 20, 64 << 20, spoolPolicy) < 0) {
+            printf("Cannot start the replay writer\n");
+            return 1;
+        }
+        spool = &spoolStorage;
+    }
+    ScoreLog scores = {};
+    if (scoresPath && open_score_log(&scores, scoresPath, 100, 1) < 0) {
+        printf("Cannot open score log %s\n", scoresPath);
+        scoresPath = NULL;
+    }
+    uint32_t gameSeed = game.rng;
+    initialize_game(&game);//FUCTION CALL TO START THE GAME
+    if (loadSave) {
+        size_t used;
+        int loaded = read_saved_game(&game, saveData + SAVE_HEADER_SIZE, saveSize - SAVE_HEADER_SIZE, &used) == 0;
+        free(saveData);
+        if (!loaded) {
+            printf("Saved game %s is corrupt or from another version\n", savePath);
+            return 1;
+        }
+        rules = game.rules;
+        gameSeed = 0;//not from a seed, the score log records 0
+    }
+    if (replayPath && seekTick > 0 && seek_replay(&replay, &game, (uint32_t)seekTick) < 0) {
+        printf("Cannot seek to tick %ld of %u\n", seekTick, replay.header.ticks);
+        return 1;
+    }
+
+    if (headless) {
+        int result = run_headless(&game, autopilotName ? &autopilot : NULL, replayPath ? &replay : NULL, recordPrefix ? &recorder : NULL, maxTicks);
+        uint64_t replayHash = recordPrefix ? save_recording(&recorder, &game, recordPrefix, &recordedGames, spool, compressReplays) : 0;
+        if (scoresPath && game.isGameOver) record_score(&scores, &game, gameSeed, replayHash);
+        if (scoresPath) close_score_log(&scores);
+        if (spool) close_replay_spool(spool);
+        free_replay_writer(&recorder);
+        if (replayPath) close_replay(&replay);
+        free(replayData);
+        destroy_agent(&autopilot);
+        destroy_distance_field(&foodDistance);
+        destroy_game(&game);
+        return result;
+    }
+
+    int phase = profile_begin(&startup, "SDL_Init", NULL);
+    int initFailed = SDL_Init(SDL_INIT_VIDEO | (mute ? 0 : SDL_INIT_AUDIO)) < 0;
+    profile_end(&startup, phase);
+    phase = profile_begin(&startup, "TTF_Init", NULL);
+    initFailed = initFailed || TTF_Init() == -1;
+    profile_end(&startup, phase);
+    if (!mute) {
+        phase = profile_begin(&startup, "Mix_OpenAudio", NULL);
+        initFailed = initFailed || Mix_OpenAudio(44100, MIX_DEFAULT_FORMAT, 2, 2048) < 0;
+        profile_end(&startup, phase);
+    }
+    if (initFailed) {
         return 1;
     }
     
+    phase = profile_begin(&startup, "SDL_CreateWindow", NULL);
     SDL_Window *gameWindow = SDL_CreateWindow("Snake Game", SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED, SCREEN_WIDTH, SCREEN_HEIGHT, SDL_WINDOW_SHOWN);
+    profile_end(&startup, phase);
+    phase = profile_begin(&startup, "SDL_CreateRenderer", NULL);
     SDL_Renderer *gameRenderer = SDL_CreateRenderer(gameWindow, -1, SDL_RENDERER_ACCELERATED);//A WINDOW WHERE THE RENDERER WILL DRAW
+    profile_end(&startup, phase);
     if (!gameWindow || !gameRenderer) {
         return 1;
     }
     
-    TTF_Font *gameFont = TTF_OpenFont("arial.ttf", 30);//OPEN A TRUETYPE FONT FILE
-    Mix_Chunk *foodSound = Mix_LoadWAV("foodsound.mp3");
-    Mix_Music *backgroundMusic = Mix_LoadMUS("snakesound.mp3");
-    SDL_Texture *foodImage = load_asset(gameRenderer, "food.png");
-    SDL_Texture *snakeImage = load_asset(gameRenderer, "snake.png");
-    SDL_Texture *backgroundImage = load_asset(gameRenderer, "background4_0snake.png");
-    SDL_Texture *bonusFoodImage = load_asset(gameRenderer, "BonusFood3.jpg");
+    Uint32 textureFormat = native_texture_format(gameRenderer);
     
-    if (!gameFont || !foodSound || !backgroundMusic || !foodImage || !snakeImage || !backgroundImage || !bonusFoodImage) {
-        return 1;
+    phase = profile_begin(&startup, "TTF_OpenFont", "arial.ttf");
+    TTF_Font *gameFont = TTF_OpenFontRW(open_asset("arial.ttf"), 1, 30);//OPEN A TRUETYPE FONT FILE
+    profile_end(&startup, phase);
+    GlyphAtlas hudFont = {};
+    if (gameFont) {
+        phase = profile_begin(&startup, "bake_glyph_atlas", "arial.ttf");
+        int baked = bake_glyph_atlas(&hudFont, gameRenderer, textureFormat, gameFont) == 0;
+        profile_end(&startup, phase);
+        TTF_CloseFont(gameFont);//the atlas is all the HUD needs from here on
+        if (!baked) {
+            return 1;
+        }
     }
     
-    srand(time(NULL));//RANDOM NUMBER GENERATOR
-    
-    SnakeGame snake;//POSITION ,LENGTH ,VELOCITY
-    RegularFood regularFood;//POSIOTION ,ACTIVE
-    BonusFood bonusFood;
-    int score = 0, gameSpeed = INITIAL_SPEED, foodCount = 0;
+    Mix_Chunk *foodSound = NULL;
+    Mix_Music *backgroundMusic = NULL;
+    if (!mute) {
+        phase = profile_begin(&startup, "Mix_LoadWAV", "foodsound.mp3");
+        foodSound = Mix_LoadWAV_RW(open_asset("foodsound.mp3"), 1);
+        profile_end(&startup, phase);
+        phase = profile_begin(&startup, "Mix_LoadMUS", "snakesound.mp3");
+        backgroundMusic = Mix_LoadMUS_RW(open_asset("snakesound.mp3"), 1);
+        profile_end(&startup, phase);
+    }
+    phase = profile_begin(&startup, "load_asset", "food.png");
+    SDL_Texture *foodImage = load_asset(gameRenderer, textureFormat, "food.png");
+    profile_end(&startup, phase);
+    phase = profile_begin(&startup, "load_asset", "snake.png");
+    SDL_Texture *snakeImage = load_asset(gameRenderer, textureFormat, "snake.png");
+    profile_end(&startup, phase);
+    phase = profile_begin(&startup, "load_asset", "background4_0snake.png");
+    SDL_Texture *backgroundImage = load_asset(gameRenderer, textureFormat, "background4_0snake.png");
+    profile_end(&startup, phase);
+    phase = profile_begin(&startup, "load_asset", "BonusFood3.jpg");
+    SDL_Texture *bonusFoodImage = load_asset(gameRenderer, textureFormat, "BonusFood3.jpg");
+    profile_end(&startup, phase);
+    SDL_Texture *poisonFoodImage = NULL;
+    if (rules.poisonEnabled) {
+        phase = profile_begin(&startup, "load_asset", "applebody.jpg");
+        poisonFoodImage = load_asset(gameRenderer, textureFormat, "applebody.jpg");
+        profile_end(&startup, phase);
+    }
     
-    initialize_game(&snake, &regularFood, &bonusFood, &score, &gameSpeed, &foodCount);//FUCTION CALL TO START THE GAME
+    if (!gameFont || (!mute && (!foodSound || !backgroundMusic)) || !foodImage || !snakeImage || !backgroundImage || !bonusFoodImage || (rules.poisonEnabled && !poisonFoodImage)) {
+        return 1;
+    }
     
-    bool isRunning = 1, isGameOver = 0;
+    bool isRunning = 1;
     SDL_Event gameEvent;//KEY PRESS,MOUSE MOVEMENT,,GAME EVENT =THE VARIABLE WHERE EVENT ARE STORED
     
-    Mix_PlayMusic(backgroundMusic, -1); // Start background music
+    if (backgroundMusic) Mix_PlayMusic(backgroundMusic, -1); // Start background music
     
     while (isRunning) {
         while (SDL_PollEvent(&gameEvent)) {
             if (gameEvent.type == SDL_QUIT) {
                 isRunning = 0;
             }
-            if (gameEvent.type == SDL_KEYDOWN) {
+            if (gameEvent.type == SDL_KEYDOWN && !replayPath) {//a replay ignores the keyboard, it would steer the game off the recording
                 switch (gameEvent.key.keysym.sym) {
                     case SDLK_UP: 
-                        if (snake.movement.y == 0) snake.movement = (Position){0, -1};
+                        steer_snake(&game.snake, (Position){0, -1});
                         break;
                     case SDLK_DOWN: 
-                        if (snake.movement.y == 0) snake.movement = (Position){0, 1};
+                        steer_snake(&game.snake, (Position){0, 1});
                         break;
                     case SDLK_LEFT: 
-                        if (snake.movement.x == 0) snake.movement = (Position){-1, 0};
+                        steer_snake(&game.snake, (Position){-1, 0});
                         break;
                     case SDLK_RIGHT: 
-                        if (snake.movement.x == 0) snake.movement = (Position){1, 0};
+                        steer_snake(&game.snake, (Position){1, 0});
+                        break;
+                    case SDLK_F5:
+                        if (save_games(savePath, &game, 1) < 0) printf("Cannot save the game to %s\n", savePath);
+                        break;
+                    case SDLK_F9:
+                        if (recordPrefix) {
+                            printf("Loading is off while recording\n");
+                        } else if (load_game(savePath, &game) < 0) {
+                            printf("Cannot load a game for this board from %s\n", savePath);
+                        } else {
+                            gameSeed = 0;
+                            if (game.rules.poisonEnabled && !poisonFoodImage) {//saved under the poison rules
+                                poisonFoodImage = load_asset(gameRenderer, textureFormat, "applebody.jpg");
+                            }
+                        }
                         break;
                     case SDLK_r: 
-                        if (isGameOver) {
-                            initialize_game(&snake, &regularFood, &bonusFood, &score, &gameSpeed, &foodCount);
-                            isGameOver = 0;
+                        if (game.isGameOver && !replayPath) {
+                            if (recordPrefix) begin_replay(&recorder, &game, keyframeInterval);
+                            gameSeed = game.rng;
+                            initialize_game(&game);
                         }
                         break;
                 }
             }
         }
         
-        if (!isGameOver) {
-            update_snake(&snake);
-            
-            if (check_border_collision(&snake) || check_self_collision(&snake)) {
-                isGameOver = 1;
-            }
-            
-            // Regular food consumption
-            if (snake.body[0].x == regularFood.location.x && snake.body[0].y == regularFood.location.y) {
-                snake.length++;
-                score++;
-                foodCount++;
-                spawn_new_food(&regularFood, &bonusFood, &snake, &foodCount);
+        if (!game.isGameOver && (!replayPath || game.tick < replay.header.ticks)) {
+            int events = advance_game(&game, autopilotName ? &autopilot : NULL, replayPath ? &replay : NULL, recordPrefix ? &recorder : NULL);
+            if ((events & STEP_ATE_FOOD) && foodSound) {
                 Mix_PlayChannel(-1, foodSound, 0);
-                if (gameSpeed > 50) gameSpeed -= 5; // Increase speed after eating food REDUCE GAME SPEED BY 5 SEC
             }
-            
-            // Bonus food consumption
-            if (bonusFood.isActive && snake.body[0].x == bonusFood.location.x && snake.body[0].y == bonusFood.location.y) {
-                score += 5;  // Extra points from bonus food
-                bonusFood.isActive = 0;
+            if (game.isGameOver) {
+                uint64_t replayHash = recordPrefix ? save_recording(&recorder, &game, recordPrefix, &recordedGames, spool, compressReplays) : 0;
+                if (scoresPath) record_score(&scores, &game, gameSeed, replayHash);
             }
         }
         
@@ -205,37 +610,57 @@ int main(int argc, char *argv[]) {
         SDL_RenderCopy(gameRenderer, backgroundImage, NULL, &backgroundRect);
         
         // Render regular food
-        SDL_Rect foodRect = {regularFood.location.x * BLOCK_DIMENSION, regularFood.location.y * BLOCK_DIMENSION, BLOCK_DIMENSION, BLOCK_DIMENSION};
+        SDL_Rect foodRect = {game.food.location.x * BLOCK_DIMENSION, game.food.location.y * BLOCK_DIMENSION, BLOCK_DIMENSION, BLOCK_DIMENSION};
         SDL_RenderCopy(gameRenderer, foodImage, NULL, &foodRect);
         
         // Render bonus food
-        if (bonusFood.isActive) {
-            SDL_Rect bonusFoodRect = {bonusFood.location.x * BLOCK_DIMENSION, bonusFood.location.y * BLOCK_DIMENSION, BLOCK_DIMENSION, BLOCK_DIMENSION};
+        if (game.bonus.isActive) {
+            SDL_Rect bonusFoodRect = {game.bonus.location.x * BLOCK_DIMENSION, game.bonus.location.y * BLOCK_DIMENSION, BLOCK_DIMENSION, BLOCK_DIMENSION};
             SDL_RenderCopy(gameRenderer, bonusFoodImage, NULL, &bonusFoodRect);
         }
         
+        // Render poisonous food
+        if (game.poison.isActive && poisonFoodImage) {
+            SDL_Rect poisonFoodRect = {game.poison.location.x * BLOCK_DIMENSION, game.poison.location.y * BLOCK_DIMENSION, BLOCK_DIMENSION, BLOCK_DIMENSION};
+            SDL_RenderCopy(gameRenderer, poisonFoodImage, NULL, &poisonFoodRect);
+        }
+        
         // Render snake
-        for (int i = 0; i < snake.length; i++) {
-            SDL_Rect snakeRect = {snake.body[i].x * BLOCK_DIMENSION, snake.body[i].y * BLOCK_DIMENSION, BLOCK_DIMENSION, BLOCK_DIMENSION};
+        for (int i = 0; i < game.snake.length; i++) {
+            Position segment = snake_segment(&game.snake, i);
+            SDL_Rect snakeRect = {segment.x * BLOCK_DIMENSION, segment.y * BLOCK_DIMENSION, BLOCK_DIMENSION, BLOCK_DIMENSION};
             SDL_RenderCopy(gameRenderer, snakeImage, NULL, &snakeRect);
         }
         
         // Render score
         char scoreText[32];
-        sprintf(scoreText, "Score: %d", score);
-        display_text(gameRenderer, gameFont, scoreText, (SDL_Color){255, 255, 255, 255}, 10, 10);
+        sprintf(scoreText, "Score: %d", game.score);
+        display_text(gameRenderer, &hudFont, scoreText, (SDL_Color){255, 255, 255, 255}, 10, 10);
         
         // Game over screen
-        if (isGameOver) {
-            display_text(gameRenderer, gameFont, "Game Over!", (SDL_Color){255, 0, 0, 255}, SCREEN_WIDTH / 2-30 , SCREEN_HEIGHT / 2-50 );
+        if (game.isGameOver) {
+            display_text(gameRenderer, &hudFont, "Game Over!", (SDL_Color){255, 0, 0, 255}, SCREEN_WIDTH / 2-30 , SCREEN_HEIGHT / 2-50 );
             char finalScore[32];
-            sprintf(finalScore, "Score: %d", score);
-            display_text(gameRenderer, gameFont, finalScore, (SDL_Color){255, 255, 255, 255}, SCREEN_WIDTH / 2 - 35, SCREEN_HEIGHT / 2);
-            display_text(gameRenderer, gameFont, "Press 'R' to Restart", (SDL_Color){255, 255, 255, 255}, SCREEN_WIDTH / 2 - 115, SCREEN_HEIGHT / 2 + 40);
+            sprintf(finalScore, "Score: %d", game.score);
+            display_text(gameRenderer, &hudFont, finalScore, (SDL_Color){255, 255, 255, 255}, SCREEN_WIDTH / 2 - 35, SCREEN_HEIGHT / 2);
+            display_text(gameRenderer, &hudFont, "Press 'R' to Restart", (SDL_Color){255, 255, 255, 255}, SCREEN_WIDTH / 2 - 115, SCREEN_HEIGHT / 2 + 40);
+            if (scoresPath && scores.bestCount > 0) {
+                char bestScore[32];
+                sprintf(bestScore, "Best: %d", scores.best[0].score);
+                display_text(gameRenderer, &hudFont, bestScore, (SDL_Color){255, 255, 255, 255}, SCREEN_WIDTH / 2 - 35, SCREEN_HEIGHT / 2 + 80);
+            }
         }
         
         SDL_RenderPresent(gameRenderer);
-        SDL_Delay(isGameOver ? 300 : gameSpeed); // Delay to control speed
+        if (profileStartup) {//report once, right after the first frame is on screen
+            FILE *profileFile = profilePath ? fopen(profilePath, "w") : stdout;
+            if (profileFile) {
+                write_startup_profile(&startup, SDL_GetPerformanceCounter(), profileFile);
+                if (profileFile != stdout) fclose(profileFile);
+            }
+            profileStartup = 0;
+        }
+        SDL_Delay(game.isGameOver ? 300 : game.speed); // Delay to control speed
     }
     
     // Cleanup resources
@@ -243,12 +668,24 @@ int main(int argc, char *argv[]) {
     SDL_DestroyTexture(snakeImage);
     SDL_DestroyTexture(backgroundImage);
     SDL_DestroyTexture(bonusFoodImage);
+    if (poisonFoodImage) SDL_DestroyTexture(poisonFoodImage);
     Mix_FreeChunk(foodSound);
     Mix_FreeMusic(backgroundMusic);
-    TTF_CloseFont(gameFont);
+    SDL_DestroyTexture(hudFont.texture);
     SDL_DestroyRenderer(gameRenderer);
     SDL_DestroyWindow(gameWindow);
-    Mix_CloseAudio();
+    if (!mute) Mix_CloseAudio();
+    if (recordPrefix && !game.isGameOver && game.tick > 0) {//keep the unfinished game too
+        save_recording(&recorder, &game, recordPrefix, &recordedGames, spool, compressReplays);
+    }
+    if (spool) close_replay_spool(spool);
+    free_replay_writer(&recorder);
+    if (scoresPath) close_score_log(&scores);
+    if (replayPath) close_replay(&replay);
+    free(replayData);
+    destroy_agent(&autopilot);
+    destroy_distance_field(&foodDistance);
+    destroy_game(&game);
     SDL_Quit();
     TTF_Quit();
     return 0;
@@ -0,0 +1,230 @@
+#include "mcts_agent.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MCTS_NODES_PER_TREE 65536
+#define MCTS_CHUNK 32           // playouts per task before the tree is resubmitted
+#define MCTS_EXPLORATION 1.4
+#define MCTS_FOOD_DISCOUNT 0.95
+
+MctsConfig default_mcts_config(void) {
+    MctsConfig config;
+    config.threads = SDL_GetCPUCount();
+    config.maxIterations = 0;
+    config.timeLimitMs = 20;
+    config.rolloutDepth = 40;
+    return config;
+}
+
+int create_mcts_agent(MctsAgent *agent, int width, int height, const MctsConfig *config) {
+    memset(agent, 0, sizeof(*agent));
+    agent->config = *config;
+    if (agent->config.threads < 1) agent->config.threads = 1;
+    agent->trees = (MctsTree *)calloc(agent->config.threads, sizeof(MctsTree));
+    if (!agent->trees || create_thread_pool(&agent->pool, agent->config.threads) < 0) {
+        free(agent->trees);
+        agent->trees = NULL;
+        return -1;
+    }
+    for (int i = 0; i < agent->config.threads; i++) {
+        MctsTree *tree = &agent->trees[i];
+        tree->agent = agent;
+        tree->rng = 0x2545f491u * (uint32_t)(i + 1);
+        tree->nodes = (MctsNode *)malloc(sizeof(MctsNode) * MCTS_NODES_PER_TREE);
+        if (!tree->nodes || create_game(&tree->scratch, width, height, 1) < 0) {
+            destroy_mcts_agent(agent);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+void destroy_mcts_agent(MctsAgent *agent) {
+    if (agent->pool.threads) {
+        destroy_thread_pool(&agent->pool);
+    }
+    for (int i = 0; agent->trees && i < agent->config.threads; i++) {
+        free(agent->trees[i].nodes);
+        destroy_game(&agent->trees[i].scratch);
+    }
+    free(agent->trees);
+    agent->trees = NULL;
+}
+
+static uint32_t tree_random(MctsTree *tree) {
+    uint32_t x = tree->rng;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    tree->rng = x;
+    return x;
+}
+
+static int new_node(MctsTree *tree) {
+    if (tree->nodeCount == MCTS_NODES_PER_TREE) {
+        return -1;//tree is full, keep playing out from the deepest node reached
+    }
+    MctsNode *node = &tree->nodes[tree->nodeCount];
+    node->children[0] = node->children[1] = node->children[2] = node->children[3] = -1;
+    node->visits = 0;
+    node->value = 0;
+    return tree->nodeCount++;
+}
+
+static int is_reversal(const GameState *game, int direction) {
+    Position move = direction_movement(direction);
+    return move.x == -game->snake.movement.x && move.y == -game->snake.movement.y;
+}
+
+static int is_safe(const GameState *game, int direction) {
+    const SnakeGame *snake = &game->snake;
+    Position head = snake_segment(snake, 0), move = direction_movement(direction);
+    Position next = {head.x + move.x, head.y + move.y};
+    if (check_border_collision(game, next)) return 0;
+    Position tail = snake_segment(snake, snake->length - 1);
+    return !check_self_collision(game, next) || (next.x == tail.x && next.y == tail.y);
+}
+
+// Mostly greedy towards the food among safe moves, random otherwise
+static int rollout_move(MctsTree *tree, const GameState *game) {
+    int safe[4], safeCount = 0, greedy = -1, bestDistance = 1 << 30;
+    Position head = snake_segment(&game->snake, 0);
+    for (int d = 0; d < 4; d++) {
+        if (is_reversal(game, d) || !is_safe(game, d)) continue;
+        safe[safeCount++] = d;
+        Position move = direction_movement(d);
+        int distance = abs(head.x + move.x - game->food.location.x) + abs(head.y + move.y - game->food.location.y);
+        if (distance < bestDistance) {
+            bestDistance = distance;
+            greedy = d;
+        }
+    }
+    if (safeCount == 0) return movement_direction(game->snake.movement);
+    if (tree_random(tree) % 4 != 0) return greedy;
+    return safe[tree_random(tree) % safeCount];
+}
+
+// Records the tick of the first food eaten during the playout
+static void play(GameState *game, int direction, int *foodTick, int tick) {
+    steer_snake(&game->snake, direction_movement(direction));
+    if ((step_game(game) & STEP_ATE_FOOD) && *foodTick < 0) {
+        *foodTick = tick;
+    }
+}
+
+// Survival is worth half, food is worth the other half the sooner it is eaten
+static double reward(const GameState *game, int foodTick) {
+    int died = game->isGameOver && game->snake.length < game->width * game->height;
+    return (died ? 0.0 : 0.5) + (foodTick >= 0 ? 0.5 * pow(MCTS_FOOD_DISCOUNT, foodTick) : 0.0);
+}
+
+static void run_playout(MctsTree *tree) {
+    const GameState *root = tree->agent->root;
+    GameState *game = &tree->scratch;
+    copy_game(game, root);
+    game->rng = tree_random(tree) | 1;//the real food sequence stays hidden from the search
+
+    int path[256], depth = 0, foodTick = -1;
+    int node = 0;
+    path[depth++] = node;
+    while (!game->isGameOver && depth < 256) {
+        int untried[4], untriedCount = 0, best = -1;
+        double bestScore = -1.0;
+        MctsNode *current = &tree->nodes[node];
+        for (int d = 0; d < 4; d++) {
+            if (is_reversal(game, d)) continue;
+            int child = current->children[d];
+            if (child < 0) {
+                untried[untriedCount++] = d;
+                continue;
+            }
+            MctsNode *c = &tree->nodes[child];
+            double score = c->value / c->visits + MCTS_EXPLORATION * sqrt(log((double)current->visits) / c->visits);
+            if (score > bestScore) {
+                bestScore = score;
+                best = d;
+            }
+        }
+        if (untriedCount > 0) {
+            int d = untried[tree_random(tree) % untriedCount];
+            int child = new_node(tree);
+            if (child >= 0) {
+                tree->nodes[node].children[d] = child;
+                play(game, d, &foodTick, depth);
+                path[depth++] = child;
+            }
+            break;
+        }
+        play(game, best, &foodTick, depth);
+        node = current->children[best];
+        path[depth++] = node;
+    }
+
+    for (int i = 0; i < tree->agent->config.rolloutDepth && !game->isGameOver; i++) {
+        play(game, rollout_move(tree, game), &foodTick, depth + i);
+    }
+
+    double value = reward(game, foodTick);
+    for (int i = 0; i < depth; i++) {
+        tree->nodes[path[i]].visits++;
+        tree->nodes[path[i]].value += value;
+    }
+    tree->iterations++;
+}
+
+static int budget_left(MctsAgent *agent) {
+    if (agent->countIterations && SDL_AtomicAdd(&agent->iterationsLeft, -1) <= 0) {
+        return 0;
+    }
+    return agent->config.timeLimitMs <= 0 || SDL_GetPerformanceCounter() < agent->deadline;
+}
+
+static void search_chunk(void *arg) {
+    MctsTree *tree = (MctsTree *)arg;
+    for (int i = 0; i < MCTS_CHUNK; i++) {
+        if (!budget_left(tree->agent)) {
+            return;
+        }
+        run_playout(tree);
+    }
+    submit_task(&tree->agent->pool, search_chunk, tree);//continue on this worker unless another steals it
+}
+
+int mcts_agent_decide(MctsAgent *agent, const GameState *game) {
+    agent->root = game;
+    agent->deadline = SDL_GetPerformanceCounter() + SDL_GetPerformanceFrequency() * (Uint64)agent->config.timeLimitMs / 1000;
+    long iterations = agent->config.maxIterations;
+    if (iterations <= 0 && agent->config.timeLimitMs <= 0) iterations = 1000;//no budget given, do not search forever
+    agent->countIterations = iterations > 0;
+    SDL_AtomicSet(&agent->iterationsLeft, (int)(iterations > 0x7fffffff ? 0x7fffffff : iterations));
+
+    for (int i = 0; i < agent->config.threads; i++) {
+        MctsTree *tree = &agent->trees[i];
+        tree->nodeCount = 0;
+        tree->iterations = 0;
+        new_node(tree);
+        submit_task(&agent->pool, search_chunk, tree);
+    }
+    wait_thread_pool(&agent->pool);
+
+    long visits[4] = {0, 0, 0, 0};
+    agent->lastIterations = 0;
+    for (int i = 0; i < agent->config.threads; i++) {
+        MctsTree *tree = &agent->trees[i];
+        agent->lastIterations += tree->iterations;
+        for (int d = 0; d < 4; d++) {
+            int child = tree->nodes[0].children[d];
+            if (child >= 0) visits[d] += tree->nodes[child].visits;
+        }
+    }
+    int best = movement_direction(game->snake.movement);
+    long bestVisits = -1;
+    for (int d = 0; d < 4; d++) {
+        if (!is_reversal(game, d) && visits[d] > bestVisits) {
+            bestVisits = visits[d];
+            best = d;
+        }
+    }
+    return best;
+}
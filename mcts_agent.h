@@ -0,0 +1,51 @@
+#ifndef MCTS_AGENT_H
+#define MCTS_AGENT_H
+
+#include "snake_engine.h"
+#include "thread_pool.h"
+
+// Monte Carlo tree search over step_game() with root parallelization: every
+// worker grows its own tree from the current state in short chunks on a
+// work-stealing pool, and the root visit counts are summed to pick the move.
+
+typedef struct {
+    int threads;            // independent trees searched in parallel
+    long maxIterations;     // playouts per decision over all trees, 0 for no limit
+    int timeLimitMs;        // wall-clock budget per decision, 0 for no limit
+    int rolloutDepth;       // ticks simulated after leaving the tree
+} MctsConfig;
+
+typedef struct {
+    int children[4];    // node index per direction, -1 until expanded
+    int visits;
+    double value;       // sum of playout rewards through this node
+} MctsNode;
+
+typedef struct MctsAgent MctsAgent;
+
+typedef struct {
+    MctsAgent *agent;
+    MctsNode *nodes;
+    int nodeCount;
+    GameState scratch;  // playout state, reset from the root every iteration
+    uint32_t rng;       // samples food spawns and rollout moves
+    long iterations;
+} MctsTree;
+
+struct MctsAgent {
+    MctsConfig config;
+    ThreadPool pool;
+    MctsTree *trees;
+    const GameState *root;
+    Uint64 deadline;
+    int countIterations;    // decision is bounded by playouts rather than only by time
+    SDL_atomic_t iterationsLeft;
+    long lastIterations;    // playouts run for the most recent decision
+};
+
+MctsConfig default_mcts_config(void);
+int create_mcts_agent(MctsAgent *agent, int width, int height, const MctsConfig *config);
+void destroy_mcts_agent(MctsAgent *agent);
+int mcts_agent_decide(MctsAgent *agent, const GameState *game);
+
+#endif
@@ -0,0 +1,29 @@
+#include "observation.h"
+#include "distance_field.h"
+#include <string.h>
+
+void encode_observation(const GameState *game, float *out) {
+    int planeSize = game->width * game->height;
+    memset(out, 0, sizeof(float) * observation_size(game->width, game->height));
+    float *body = out + OBSERVATION_BODY * planeSize;
+    for (int i = 0; i < game->snake.length; i++) {
+        body[cell_index(game, snake_segment(&game->snake, i))] = 1.0f;
+    }
+    out[OBSERVATION_HEAD * planeSize + cell_index(game, snake_segment(&game->snake, 0))] = 1.0f;
+    if (game->food.isActive) {
+        out[OBSERVATION_FOOD * planeSize + cell_index(game, game->food.location)] = 1.0f;
+    }
+    if (game->bonus.isActive) {
+        out[OBSERVATION_BONUS * planeSize + cell_index(game, game->bonus.location)] = 1.0f;
+    }
+    if (game->poison.isActive) {
+        out[OBSERVATION_POISON * planeSize + cell_index(game, game->poison.location)] = 1.0f;
+    }
+    const int *distance = food_distances(game);
+    if (distance) {
+        float *plane = out + OBSERVATION_FOOD_DISTANCE * planeSize;
+        for (int i = 0; i < planeSize; i++) {
+            if (distance[i] != DISTANCE_UNREACHABLE) plane[i] = 1.0f / (1.0f + distance[i]);
+        }
+    }
+}
@@ -0,0 +1,18 @@
+#ifndef OBSERVATION_H
+#define OBSERVATION_H
+
+#include "snake_engine.h"
+
+// Observation planes, each width * height floats, stored one after another.
+// OBSERVATION_FOOD_DISTANCE holds 1 / (1 + steps to the food) for cells that
+// can reach it and stays zero unless the game has a distance field attached.
+// OBSERVATION_POISON stays zero unless the rules spawn poison.
+enum { OBSERVATION_BODY, OBSERVATION_HEAD, OBSERVATION_FOOD, OBSERVATION_BONUS, OBSERVATION_FOOD_DISTANCE, OBSERVATION_POISON, OBSERVATION_CHANNELS };
+
+static inline int observation_size(int width, int height) {
+    return OBSERVATION_CHANNELS * width * height;
+}
+
+void encode_observation(const GameState *game, float *out);
+
+#endif
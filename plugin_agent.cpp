@@ -0,0 +1,78 @@
+#include "plugin_agent.h"
+#include <SDL2/SDL.h>
+#include <stdio.h>
+#include <string.h>
+
+// The view hands out the engine's own arrays, so the layouts must agree
+static_assert(sizeof(Position) == sizeof(SnakeAgentPosition), "Position must match SnakeAgentPosition");
+static_assert(sizeof(int) == sizeof(int32_t), "batched actions are passed through as int32_t");
+static_assert(DIRECTION_UP == SNAKE_AGENT_UP && DIRECTION_DOWN == SNAKE_AGENT_DOWN && DIRECTION_LEFT == SNAKE_AGENT_LEFT && DIRECTION_RIGHT == SNAKE_AGENT_RIGHT, "direction encodings must match");
+
+int load_plugin_agent(PluginAgent *agent, const char *path, int width, int height) {
+    memset(agent, 0, sizeof(*agent));
+    agent->library = SDL_LoadObject(path);
+    if (!agent->library) {
+        printf("Plugin load failed: %s\n", SDL_GetError());
+        return -1;
+    }
+    SnakeAgentApiVersionFunction version = (SnakeAgentApiVersionFunction)SDL_LoadFunction(agent->library, "snake_agent_api_version");
+    SnakeAgentCreateFunction create = (SnakeAgentCreateFunction)SDL_LoadFunction(agent->library, "snake_agent_create");
+    agent->act = (SnakeAgentActFunction)SDL_LoadFunction(agent->library, "snake_agent_act");
+    agent->destroy = (SnakeAgentDestroyFunction)SDL_LoadFunction(agent->library, "snake_agent_destroy");
+    if (!version || !create || !agent->act || !agent->destroy) {
+        printf("Plugin %s does not export the snake agent API\n", path);
+        unload_plugin_agent(agent);
+        return -1;
+    }
+    agent->actBatch = (SnakeAgentActBatchFunction)SDL_LoadFunction(agent->library, "snake_agent_act_batch");
+    int32_t pluginVersion = version();
+    if (pluginVersion < 1 || pluginVersion > SNAKE_AGENT_API_VERSION) {
+        printf("Plugin %s needs agent API version %d, this build has %d\n", path, (int)pluginVersion, SNAKE_AGENT_API_VERSION);
+        unload_plugin_agent(agent);
+        return -1;
+    }
+    agent->instance = create(width, height);
+    if (!agent->instance) {
+        unload_plugin_agent(agent);
+        return -1;
+    }
+    agent->view.apiVersion = SNAKE_AGENT_API_VERSION;
+    return 0;
+}
+
+void unload_plugin_agent(PluginAgent *agent) {
+    if (agent->instance && agent->destroy) {
+        agent->destroy(agent->instance);
+    }
+    if (agent->library) {
+        SDL_UnloadObject(agent->library);
+    }
+    memset(agent, 0, sizeof(*agent));
+}
+
+int plugin_agent_decide(PluginAgent *agent, const GameState *game) {
+    SnakeAgentView *view = &agent->view;
+    view->width = game->width;
+    view->height = game->height;
+    view->body = (const SnakeAgentPosition *)game->snake.body;
+    view->bodyCapacity = game->snake.capacity;
+    view->bodyHead = game->snake.head;
+    view->length = game->snake.length;
+    view->movement = (SnakeAgentPosition){game->snake.movement.x, game->snake.movement.y};
+    view->cells = game->cells;
+    view->food = (SnakeAgentPosition){game->food.location.x, game->food.location.y};
+    view->foodActive = game->food.isActive;
+    view->bonus = (SnakeAgentPosition){game->bonus.location.x, game->bonus.location.y};
+    view->bonusActive = game->bonus.isActive;
+    view->score = game->score;
+    view->tick = game->tick;
+    view->poison = (SnakeAgentPosition){game->poison.location.x, game->poison.location.y};
+    view->poisonActive = game->poison.isActive;
+    return agent->act(agent->instance, view) & 3;
+}
+
+// BatchPolicyFunction adapter, only for plugins that export snake_agent_act_batch
+void plugin_agent_decide_batch(void *agent, const float *observations, int count, int observationSize, int *actions) {
+    PluginAgent *plugin = (PluginAgent *)agent;
+    plugin->actBatch(plugin->instance, observations, count, observationSize, (int32_t *)actions);
+}
@@ -0,0 +1,22 @@
+#ifndef PLUGIN_AGENT_H
+#define PLUGIN_AGENT_H
+
+#include "snake_engine.h"
+#include "snake_agent_api.h"
+
+// Agent implemented in a shared library against snake_agent_api.h
+typedef struct {
+    void *library;
+    void *instance;
+    SnakeAgentActFunction act;
+    SnakeAgentDestroyFunction destroy;
+    SnakeAgentActBatchFunction actBatch;    // NULL when the plugin has no batched entry point
+    SnakeAgentView view;
+} PluginAgent;
+
+int load_plugin_agent(PluginAgent *agent, const char *path, int width, int height);
+void unload_plugin_agent(PluginAgent *agent);
+int plugin_agent_decide(PluginAgent *agent, const GameState *game);
+void plugin_agent_decide_batch(void *agent, const float *observations, int count, int observationSize, int *actions);
+
+#endif
@@ -0,0 +1,229 @@
+#include "reachability.h"
+#include <stdlib.h>
+#include <string.h>
+
+int create_reachability(ReachabilityTracker *tracker, int width, int height) {
+    int cellCount = width * height;
+    memset(tracker, 0, sizeof(*tracker));
+    tracker->width = width;
+    tracker->height = height;
+    tracker->nodeCapacity = 2 * cellCount;//every tail step between rebuilds takes a fresh node
+    tracker->nodeOf = (int *)malloc(sizeof(int) * cellCount);
+    tracker->parent = (int *)malloc(sizeof(int) * tracker->nodeCapacity);
+    tracker->size = (int *)malloc(sizeof(int) * tracker->nodeCapacity);
+    tracker->queue = (int *)malloc(sizeof(int) * cellCount);
+    tracker->visited = (uint32_t *)calloc(cellCount, sizeof(uint32_t));
+    tracker->dirty = 1;
+    if (!tracker->nodeOf || !tracker->parent || !tracker->size || !tracker->queue || !tracker->visited) {
+        destroy_reachability(tracker);
+        return -1;
+    }
+    return 0;
+}
+
+void destroy_reachability(ReachabilityTracker *tracker) {
+    free(tracker->nodeOf);
+    free(tracker->parent);
+    free(tracker->size);
+    free(tracker->queue);
+    free(tracker->visited);
+    memset(tracker, 0, sizeof(*tracker));
+}
+
+static int find_root(ReachabilityTracker *tracker, int node) {
+    while (tracker->parent[node] != node) {
+        tracker->parent[node] = tracker->parent[tracker->parent[node]];
+        node = tracker->parent[node];
+    }
+    return node;
+}
+
+static void join(ReachabilityTracker *tracker, int a, int b) {
+    a = find_root(tracker, a);
+    b = find_root(tracker, b);
+    if (a == b) return;
+    if (tracker->size[a] < tracker->size[b]) {
+        int swap = a;
+        a = b;
+        b = swap;
+    }
+    tracker->parent[b] = a;
+    tracker->size[a] += tracker->size[b];
+}
+
+static int is_free(const GameState *game, int x, int y) {
+    return x >= 0 && x < game->width && y >= 0 && y < game->height && !game->cells[y * game->width + x];
+}
+
+void rebuild_reachability(ReachabilityTracker *tracker, const GameState *game) {
+    int cellCount = game->width * game->height;
+    for (int cell = 0; cell < cellCount; cell++) {
+        tracker->nodeOf[cell] = cell;
+        tracker->parent[cell] = cell;
+        tracker->size[cell] = game->cells[cell] ? 0 : 1;
+    }
+    for (int cell = 0; cell < cellCount; cell++) {
+        if (game->cells[cell]) continue;
+        int x = cell % game->width, y = cell / game->width;
+        if (is_free(game, x + 1, y)) join(tracker, cell, cell + 1);
+        if (is_free(game, x, y + 1)) join(tracker, cell, cell + game->width);
+    }
+    tracker->nodeCount = cellCount;
+    tracker->dirty = 0;
+    tracker->lastGame = game;
+    tracker->lastTick = game->tick;
+    tracker->lastHead = snake_segment(&game->snake, 0);
+    tracker->lastTail = snake_segment(&game->snake, game->snake.length - 1);
+    tracker->rebuilds++;
+}
+
+// Removing cell p keeps every region connected when its free edge neighbours
+// all lie on one run of free cells around its 3x3 ring. blocked counts as
+// occupied, for judging the head against the state before the tail moved.
+static int is_simple_cell(const GameState *game, Position p, Position blocked) {
+    static const int ringX[8] = {0, 1, 1, 1, 0, -1, -1, -1};
+    static const int ringY[8] = {-1, -1, 0, 1, 1, 1, 0, -1};
+    int freeRing[8], start = -1;
+    for (int i = 0; i < 8; i++) {
+        int x = p.x + ringX[i], y = p.y + ringY[i];
+        freeRing[i] = is_free(game, x, y) && !(x == blocked.x && y == blocked.y);
+        if (!freeRing[i]) start = i;
+    }
+    if (start < 0) return 1;
+    int runs = 0, runHasEdge = 0;
+    for (int k = 1; k <= 8; k++) {
+        int i = (start + k) % 8;
+        if (freeRing[i]) {
+            runHasEdge |= i % 2 == 0;//even ring slots are the edge neighbours
+        } else {
+            runs += runHasEdge;
+            runHasEdge = 0;
+        }
+    }
+    return runs <= 1;
+}
+
+static int same_cell(Position a, Position b) {
+    return a.x == b.x && a.y == b.y;
+}
+
+// Whether the regions are those of this game as it is now
+static int describes_game(const ReachabilityTracker *tracker, const GameState *game) {
+    const SnakeGame *snake = &game->snake;
+    return !tracker->dirty && tracker->lastGame == game && tracker->lastTick == game->tick
+        && same_cell(tracker->lastHead, snake_segment(snake, 0)) && same_cell(tracker->lastTail, snake_segment(snake, snake->length - 1));
+}
+
+void sync_reachability(ReachabilityTracker *tracker, const GameState *game) {
+    const SnakeGame *snake = &game->snake;
+    if (tracker->dirty || tracker->lastGame != game || game->tick != tracker->lastTick + 1 || game->isGameOver
+        || snake->length < 2 || !same_cell(snake_segment(snake, 1), tracker->lastHead)) {//one step on from the last state, or anything else
+        rebuild_reachability(tracker, game);
+        return;
+    }
+    Position head = snake_segment(snake, 0);
+    Position oldTail = tracker->lastTail;
+    int headCell = cell_index(game, head), oldTailCell = cell_index(game, oldTail);
+    int tailLeft = !game->cells[oldTailCell];
+    tracker->lastTick = game->tick;
+    tracker->lastHead = head;
+    tracker->lastTail = snake_segment(snake, snake->length - 1);
+    if (headCell == oldTailCell) {
+        return;//the head took the cell the tail just left
+    }
+
+    // Head first, against the state before the tail moved
+    Position noCell = {-2, -2};
+    if (!is_simple_cell(game, head, tailLeft ? oldTail : noCell)) {
+        tracker->dirty = 1;
+        return;
+    }
+    tracker->size[find_root(tracker, tracker->nodeOf[headCell])]--;
+
+    if (tailLeft) {
+        if (tracker->nodeCount == tracker->nodeCapacity) {
+            tracker->dirty = 1;
+            return;
+        }
+        int node = tracker->nodeCount++;
+        tracker->nodeOf[oldTailCell] = node;
+        tracker->parent[node] = node;
+        tracker->size[node] = 1;
+        static const int dx[4] = {0, 0, -1, 1}, dy[4] = {-1, 1, 0, 0};
+        for (int d = 0; d < 4; d++) {
+            int x = oldTail.x + dx[d], y = oldTail.y + dy[d];
+            if (is_free(game, x, y)) join(tracker, node, tracker->nodeOf[y * game->width + x]);
+        }
+    }
+}
+
+static int next_cell(const GameState *game, int direction, Position *next) {
+    Position head = snake_segment(&game->snake, 0), move = direction_movement(direction);
+    *next = (Position){head.x + move.x, head.y + move.y};
+    return !check_border_collision(game, *next);
+}
+
+// Free cells reachable from the head once it has moved, with the tail left in
+// place. Zero for moves into a wall or the body.
+int reachable_after_move(ReachabilityTracker *tracker, const GameState *game, int direction) {
+    Position next;
+    if (!next_cell(game, direction, &next)) return 0;
+    Position tail = snake_segment(&game->snake, game->snake.length - 1);
+    int nextCell = cell_index(game, next);
+    int intoTail = next.x == tail.x && next.y == tail.y;
+    if (game->cells[nextCell] && !intoTail) return 0;
+    if (!describes_game(tracker, game)) {
+        sync_reachability(tracker, game);
+        if (tracker->dirty) rebuild_reachability(tracker, game);
+    }
+    if (!intoTail) {
+        if (!is_simple_cell(game, next, (Position){-2, -2})) {
+            return flood_fill_after_move(tracker, game, direction);
+        }
+        return tracker->size[find_root(tracker, tracker->nodeOf[nextCell])] - 1;
+    }
+    // The tail cell stays occupied, by the head now: add up the distinct regions around it
+    static const int dx[4] = {0, 0, -1, 1}, dy[4] = {-1, 1, 0, 0};
+    int roots[4], rootCount = 0, area = 0;
+    for (int d = 0; d < 4; d++) {
+        int x = next.x + dx[d], y = next.y + dy[d];
+        if (!is_free(game, x, y)) continue;
+        int root = find_root(tracker, tracker->nodeOf[y * game->width + x]), seen = 0;
+        for (int i = 0; i < rootCount; i++) seen |= roots[i] == root;
+        if (!seen) {
+            roots[rootCount++] = root;
+            area += tracker->size[root];
+        }
+    }
+    return area;
+}
+
+// Reference answer for reachable_after_move(), by a fresh flood fill
+int flood_fill_after_move(ReachabilityTracker *tracker, const GameState *game, int direction) {
+    Position next;
+    if (!next_cell(game, direction, &next)) return 0;
+    Position tail = snake_segment(&game->snake, game->snake.length - 1);
+    int nextCell = cell_index(game, next);
+    if (game->cells[nextCell] && !(next.x == tail.x && next.y == tail.y)) return 0;
+    if (++tracker->generation == 0) {
+        memset(tracker->visited, 0, sizeof(uint32_t) * game->width * game->height);
+        tracker->generation = 1;
+    }
+    tracker->visited[nextCell] = tracker->generation;
+    int head = 0, queued = 0;
+    tracker->queue[queued++] = nextCell;
+    static const int dx[4] = {0, 0, -1, 1}, dy[4] = {-1, 1, 0, 0};
+    while (head < queued) {
+        int cell = tracker->queue[head++];
+        int x = cell % game->width, y = cell / game->width;
+        for (int d = 0; d < 4; d++) {
+            int nx = x + dx[d], ny = y + dy[d];
+            if (!is_free(game, nx, ny)) continue;
+            int neighbour = ny * game->width + nx;
+            if (tracker->visited[neighbour] == tracker->generation) continue;
+            tracker->visited[neighbour] = tracker->generation;
+            tracker->queue[queued++] = neighbour;
+        }
+    }
+    return queued - 1;
+}
@@ -0,0 +1,36 @@
+#ifndef REACHABILITY_H
+#define REACHABILITY_H
+
+#include "snake_engine.h"
+
+// Connected regions of free cells kept in a union-find as the snake moves.
+// A cell the tail leaves is a fresh node unioned with its free neighbours.
+// A cell the head enters only shrinks its region when it is a simple point
+// (its free neighbours stay connected around it); anything else may split a
+// region, which union-find cannot express, so the structure is rebuilt
+// before the next query. Queries about any other game or state than the
+// one after the last synced tick rebuild it too.
+typedef struct {
+    int width, height;
+    int *nodeOf;        // union-find node of each free cell
+    int *parent;
+    int *size;          // free cells in the region, valid at roots
+    int nodeCount, nodeCapacity;
+    int dirty;
+    const GameState *lastGame;  // the state the regions describe
+    uint32_t lastTick;
+    Position lastHead, lastTail;
+    long rebuilds;
+    int *queue;         // flood fill fallback for moves that may split a region
+    uint32_t *visited;
+    uint32_t generation;
+} ReachabilityTracker;
+
+int create_reachability(ReachabilityTracker *tracker, int width, int height);
+void destroy_reachability(ReachabilityTracker *tracker);
+void rebuild_reachability(ReachabilityTracker *tracker, const GameState *game);
+void sync_reachability(ReachabilityTracker *tracker, const GameState *game);
+int reachable_after_move(ReachabilityTracker *tracker, const GameState *game, int direction);
+int flood_fill_after_move(ReachabilityTracker *tracker, const GameState *game, int direction);
+
+#endif
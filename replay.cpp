@@ -0,0 +1,484 @@
+#include "replay.h"
+#include "byte_order.h"
+#include <dirent.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static int reserve(unsigned char **buffer, size_t *capacity, size_t needed) {
+    if (needed <= *capacity) {
+        return 0;
+    }
+    size_t size = *capacity ? *capacity : 1024;
+    while (size < needed) size *= 2;
+    unsigned char *grown = (unsigned char *)realloc(*buffer, size);
+    if (!grown) {
+        return -1;
+    }
+    *buffer = grown;
+    *capacity = size;
+    return 0;
+}
+
+// Call before initialize_game(): the seed is the PRNG state the game starts from
+int begin_replay(ReplayWriter *writer, const GameState *game, uint32_t keyframeInterval) {
+    ReplayHeader *header = &writer->header;
+    memset(header, 0, sizeof(*header));
+    header->formatVersion = REPLAY_FORMAT_VERSION;
+    header->rulesVersion = RULES_VERSION;
+    header->width = game->width;
+    header->height = game->height;
+    header->seed = game->rng;
+    header->rules = game->rules;
+    header->endReason = GAME_RUNNING;
+    header->keyframeInterval = keyframeInterval;
+    writer->keyframeBytes = 0;
+    if (game->width > 0xffff || game->height > 0xffff) {
+        return -1;
+    }
+    return reserve(&writer->actions, &writer->capacity, 1024);
+}
+
+static void encode_keyframe(const GameState *game, unsigned char *out) {
+    const SnakeGame *snake = &game->snake;
+    put_u32(out, game->tick);
+    put_u32(out + 4, game->rng);
+    put_u32(out + 8, (uint32_t)game->score);
+    put_u32(out + 12, (uint32_t)game->speed);
+    put_u32(out + 16, (uint32_t)game->foodConsumed);
+    out[20] = (unsigned char)game->isGameOver;
+    out[21] = (unsigned char)game->endReason;
+    out[22] = (unsigned char)movement_direction(snake->movement);
+    out[23] = (unsigned char)(game->food.isActive | game->bonus.isActive << 1 | game->poison.isActive << 2);
+    put_u16(out + 24, (uint32_t)game->food.location.x);
+    put_u16(out + 26, (uint32_t)game->food.location.y);
+    put_u16(out + 28, (uint32_t)game->bonus.location.x);
+    put_u16(out + 30, (uint32_t)game->bonus.location.y);
+    put_u16(out + 32, (uint32_t)game->poison.location.x);
+    put_u16(out + 34, (uint32_t)game->poison.location.y);
+    put_u32(out + 36, game->poison.spawnTick);
+    put_u32(out + 40, (uint32_t)snake->length);
+    Position previous = snake_segment(snake, 0);
+    put_u16(out + 44, (uint32_t)previous.x);
+    put_u16(out + 46, (uint32_t)previous.y);
+    unsigned char *links = out + KEYFRAME_FIXED_SIZE;
+    for (int i = 1; i < snake->length; i++) {
+        Position segment = snake_segment(snake, i);
+        Position step = {segment.x - previous.x, segment.y - previous.y};
+        if ((i - 1) % 4 == 0) links[(i - 1) / 4] = 0;
+        links[(i - 1) / 4] |= (unsigned char)(movement_direction(step) << ((i - 1) % 4 * 2));
+        previous = segment;
+    }
+}
+
+static size_t keyframe_size(int length) {
+    return KEYFRAME_FIXED_SIZE + ((size_t)length + 2) / 4;
+}
+
+// Records the heading the snake moves in on this tick, after steering, and a
+// keyframe when one is due
+int record_replay_tick(ReplayWriter *writer, const GameState *game) {
+    ReplayHeader *header = &writer->header;
+    uint32_t tick = header->ticks;
+    if (tick >= MAX_REPLAY_TICKS) {//readers would refuse the whole file
+        return -1;
+    }
+    if (header->keyframeInterval && tick > 0 && tick % header->keyframeInterval == 0) {
+        size_t size = keyframe_size(game->snake.length);
+        size_t indexBytes = (size_t)writer->indexCapacity * sizeof(uint32_t);
+        if (reserve(&writer->keyframes, &writer->keyframeCapacity, writer->keyframeBytes + size) < 0) {
+            return -1;
+        }
+        if (header->keyframeCount * 2 + 2 > writer->indexCapacity) {
+            unsigned char *index = (unsigned char *)writer->index;
+            if (reserve(&index, &indexBytes, (header->keyframeCount * 2 + 2) * sizeof(uint32_t)) < 0) {
+                return -1;
+            }
+            writer->index = (uint32_t *)index;
+            writer->indexCapacity = (uint32_t)(indexBytes / sizeof(uint32_t));
+        }
+        encode_keyframe(game, writer->keyframes + writer->keyframeBytes);
+        writer->index[header->keyframeCount * 2] = tick;
+        writer->index[header->keyframeCount * 2 + 1] = (uint32_t)writer->keyframeBytes;
+        writer->keyframeBytes += size;
+        header->keyframeCount++;
+    }
+    if (reserve(&writer->actions, &writer->capacity, (tick >> 2) + 1) < 0) {
+        return -1;
+    }
+    if ((tick & 3) == 0) {
+        writer->actions[tick >> 2] = 0;
+    }
+    writer->actions[tick >> 2] |= (unsigned char)(movement_direction(game->snake.movement) << ((tick & 3) * 2));
+    header->ticks++;
+    return 0;
+}
+
+void end_replay(ReplayWriter *writer, const GameState *game) {
+    writer->header.score = game->score;
+    writer->header.length = game->snake.length;
+    writer->header.endReason = game->endReason;
+}
+
+size_t replay_header_size(const ReplayHeader *header) {
+    return header->formatVersion == 1 ? REPLAY_V1_HEADER_SIZE : REPLAY_HEADER_SIZE;
+}
+
+// Header and actions, without any keyframes
+static size_t actions_end(const ReplayHeader *header) {
+    return replay_header_size(header) + ((size_t)header->ticks + 3) / 4;
+}
+
+size_t replay_size(const ReplayHeader *header) {
+    if (header->keyframeCount) {
+        return header->indexOffset + (size_t)header->keyframeCount * 8;
+    }
+    return actions_end(header);
+}
+
+void write_replay_header(const ReplayHeader *header, unsigned char *out) {
+    memcpy(out, "SNRP", 4);
+    put_u16(out + 4, (uint32_t)header->formatVersion);
+    put_u16(out + 6, (uint32_t)header->rulesVersion);
+    put_u16(out + 8, (uint32_t)header->width);
+    put_u16(out + 10, (uint32_t)header->height);
+    put_u32(out + 12, header->seed);
+    put_u32(out + 16, (uint32_t)header->rules.foodPoints);
+    put_u32(out + 20, (uint32_t)header->rules.bonusPoints);
+    put_u32(out + 24, (uint32_t)header->rules.poisonEnabled);
+    put_u32(out + 28, (uint32_t)header->rules.poisonPenalty);
+    put_u32(out + 32, (uint32_t)header->rules.poisonLifetime);
+    put_u32(out + 36, header->ticks);
+    put_u32(out + 40, (uint32_t)header->score);
+    put_u32(out + 44, (uint32_t)header->length);
+    put_u32(out + 48, (uint32_t)header->endReason);
+    if (header->formatVersion >= 2) {
+        put_u32(out + 52, header->keyframeInterval);
+        put_u32(out + 56, header->keyframeCount);
+        put_u32(out + 60, header->indexOffset);
+    }
+}
+
+// Size of the file save_replay() would write
+size_t encoded_replay_size(const ReplayWriter *writer) {
+    const ReplayHeader *header = &writer->header;
+    return actions_end(header) + (header->keyframeCount ? writer->keyframeBytes + (size_t)header->keyframeCount * 8 : 0);
+}
+
+// Writes the file image into out, which holds encoded_replay_size() bytes
+void encode_replay(const ReplayWriter *writer, unsigned char *out) {
+    ReplayHeader header = writer->header;
+    size_t actionsEnd = actions_end(&header);
+    header.indexOffset = header.keyframeCount ? (uint32_t)(actionsEnd + writer->keyframeBytes) : 0;
+    write_replay_header(&header, out);
+    memcpy(out + REPLAY_HEADER_SIZE, writer->actions, actionsEnd - REPLAY_HEADER_SIZE);
+    if (header.keyframeCount) {
+        memcpy(out + actionsEnd, writer->keyframes, writer->keyframeBytes);
+        unsigned char *index = out + header.indexOffset;
+        for (uint32_t i = 0; i < header.keyframeCount * 2; i++) {
+            put_u32(index + i * 4, writer->index[i] + (i & 1 ? (uint32_t)actionsEnd : 0));//offsets become absolute
+        }
+    }
+}
+
+int save_replay(const ReplayWriter *writer, const char *path) {
+    size_t size = encoded_replay_size(writer);
+    unsigned char *bytes = (unsigned char *)malloc(size);
+    if (!bytes) {
+        return -1;
+    }
+    encode_replay(writer, bytes);
+    FILE *file = fopen(path, "wb");
+    int ok = file && fwrite(bytes, 1, size, file) == size;
+    if (file) ok = fclose(file) == 0 && ok;
+    free(bytes);
+    return ok ? 0 : -1;
+}
+
+// FNV-1a over the file image, names a replay in score records
+uint64_t replay_hash(const unsigned char *data, size_t size) {
+    uint64_t hash = 0xcbf29ce484222325ull;
+    for (size_t i = 0; i < size; i++) {
+        hash = (hash ^ data[i]) * 0x100000001b3ull;
+    }
+    return hash;
+}
+
+void free_replay_writer(ReplayWriter *writer) {
+    free(writer->actions);
+    free(writer->keyframes);
+    free(writer->index);
+    writer->actions = NULL;
+    writer->keyframes = NULL;
+    writer->index = NULL;
+    writer->capacity = writer->keyframeCapacity = 0;
+    writer->indexCapacity = 0;
+}
+
+// Parses and checks the header alone, size covering at least the header
+int read_replay_header(ReplayHeader *header, const unsigned char *data, size_t size) {
+    memset(header, 0, sizeof(*header));
+    if (size < REPLAY_V1_HEADER_SIZE || memcmp(data, "SNRP", 4) != 0) {
+        return -1;
+    }
+    header->formatVersion = (int)get_u16(data + 4);
+    header->rulesVersion = (int)get_u16(data + 6);
+    header->width = (int)get_u16(data + 8);
+    header->height = (int)get_u16(data + 10);
+    header->seed = get_u32(data + 12);
+    header->rules.foodPoints = (int)get_u32(data + 16);
+    header->rules.bonusPoints = (int)get_u32(data + 20);
+    header->rules.poisonEnabled = (int)get_u32(data + 24);
+    header->rules.poisonPenalty = (int)get_u32(data + 28);
+    header->rules.poisonLifetime = (int)get_u32(data + 32);
+    header->ticks = get_u32(data + 36);
+    header->score = (int)get_u32(data + 40);
+    header->length = (int)get_u32(data + 44);
+    header->endReason = (int)get_u32(data + 48);
+    if (header->formatVersion < 1 || header->formatVersion > REPLAY_FORMAT_VERSION || header->ticks > MAX_REPLAY_TICKS) {
+        return -1;
+    }
+    if (header->formatVersion >= 2) {
+        if (size < REPLAY_HEADER_SIZE) return -1;
+        header->keyframeInterval = get_u32(data + 52);
+        header->keyframeCount = get_u32(data + 56);
+        header->indexOffset = get_u32(data + 60);
+        if (header->keyframeCount && header->indexOffset < actions_end(header)) return -1;
+    }
+    return 0;
+}
+
+// Checks the header and points the reader into data, which must outlive it
+int open_replay(ReplayReader *reader, const unsigned char *data, size_t size) {
+    memset(reader, 0, sizeof(*reader));
+    ReplayHeader *header = &reader->header;
+    if (read_replay_header(header, data, size) < 0 || size < replay_size(header)) {
+        return -1;
+    }
+    reader->data = data;
+    reader->size = size;
+    reader->actions = data + replay_header_size(header);
+    return 0;
+}
+
+void close_replay(ReplayReader *reader) {
+    free_snapshot(&reader->keyframe);
+    free(reader->cellScratch);
+    reader->cellScratch = NULL;
+}
+
+int load_file(const char *path, unsigned char **data, size_t *size) {
+    FILE *file = fopen(path, "rb");
+    if (!file) {
+        return -1;
+    }
+    fseek(file, 0, SEEK_END);
+    long length = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    *data = length >= 0 ? (unsigned char *)malloc(length ? length : 1) : NULL;
+    int ok = *data && fread(*data, 1, length, file) == (size_t)length;
+    fclose(file);
+    if (!ok) {
+        free(*data);
+        *data = NULL;
+        return -1;
+    }
+    *size = (size_t)length;
+    return 0;
+}
+
+static int add_replay_file(ReplayPathList *list, const char *path) {
+    if (list->count == list->capacity) {
+        long size = list->capacity ? list->capacity * 2 : 256;
+        char **grown = (char **)realloc(list->paths, sizeof(char *) * size);
+        if (!grown) {
+            return -1;
+        }
+        list->paths = grown;
+        list->capacity = size;
+    }
+    list->paths[list->count] = (char *)malloc(strlen(path) + 1);
+    if (!list->paths[list->count]) {
+        return -1;
+    }
+    strcpy(list->paths[list->count++], path);
+    return 0;
+}
+
+static int has_replay_extension(const char *name) {
+    size_t length = strlen(name);
+    return length > 4 && (strcmp(name + length - 4, ".snr") == 0 || strcmp(name + length - 4, ".snz") == 0);
+}
+
+static int compare_path(const void *a, const void *b) {
+    return strcmp(*(char *const *)a, *(char *const *)b);
+}
+
+// A directory contributes its .snr and .snz files in name order, one level
+// deep; anything else is taken as a replay
+int add_replay_path(ReplayPathList *list, const char *path) {
+    DIR *directory = opendir(path);
+    if (!directory) {
+        return add_replay_file(list, path);
+    }
+    long first = list->count;
+    char child[1024];
+    for (struct dirent *entry = readdir(directory); entry; entry = readdir(directory)) {
+        if (!has_replay_extension(entry->d_name)) continue;
+        snprintf(child, sizeof(child), "%s/%s", path, entry->d_name);
+        if (add_replay_file(list, child) < 0) {
+            closedir(directory);
+            return -1;
+        }
+    }
+    closedir(directory);
+    qsort(list->paths + first, list->count - first, sizeof(char *), compare_path);
+    return 0;
+}
+
+void free_replay_paths(ReplayPathList *list) {
+    for (long i = 0; i < list->count; i++) free(list->paths[i]);
+    free(list->paths);
+    list->paths = NULL;
+    list->count = list->capacity = 0;
+}
+
+// Creates the game the replay started from; a replay recorded under other
+// rules cannot be reproduced and is refused
+int start_playback(const ReplayHeader *header, GameState *game) {
+    if (header->rulesVersion != RULES_VERSION || create_game(game, header->width, header->height, header->seed) < 0) {
+        return -1;
+    }
+    game->rules = header->rules;
+    game->rng = header->seed;
+    initialize_game(game);
+    return 0;
+}
+
+// Decodes a keyframe into the reader's scratch snapshot
+static int decode_keyframe(ReplayReader *reader, uint32_t offset) {
+    const ReplayHeader *header = &reader->header;
+    if ((size_t)offset + KEYFRAME_FIXED_SIZE > reader->size) {
+        return -1;
+    }
+    const unsigned char *in = reader->data + offset;
+    int length = (int)get_u32(in + 40);
+    if (length < 1 || length > header->width * header->height || offset + keyframe_size(length) > reader->size) {
+        return -1;
+    }
+    GameState game = {};
+    game.width = header->width;
+    game.height = header->height;
+    game.rules = header->rules;
+    game.tick = get_u32(in);
+    game.rng = get_u32(in + 4);
+    game.score = (int)get_u32(in + 8);
+    game.speed = (int)get_u32(in + 12);
+    game.foodConsumed = (int)get_u32(in + 16);
+    game.isGameOver = in[20];
+    game.endReason = in[21];
+    game.snake.movement = direction_movement(in[22]);
+    game.food.isActive = in[23] & 1;
+    game.bonus.isActive = (in[23] >> 1) & 1;
+    game.poison.isActive = (in[23] >> 2) & 1;
+    game.food.location = (Position){(int)get_u16(in + 24), (int)get_u16(in + 26)};
+    game.bonus.location = (Position){(int)get_u16(in + 28), (int)get_u16(in + 30)};
+    game.poison.location = (Position){(int)get_u16(in + 32), (int)get_u16(in + 34)};
+    game.poison.spawnTick = get_u32(in + 36);
+    game.snake.length = length;
+    game.snake.capacity = header->width * header->height;
+    if (in[22] > DIRECTION_RIGHT) {
+        return -1;
+    }
+    GameSnapshot *snapshot = &reader->keyframe;
+    if (length > snapshot->segmentCapacity) {
+        Position *segments = (Position *)realloc(snapshot->segments, sizeof(Position) * length);
+        if (!segments) {
+            return -1;
+        }
+        snapshot->segments = segments;
+        snapshot->segmentCapacity = length;
+    }
+    const unsigned char *links = in + KEYFRAME_FIXED_SIZE;
+    Position *segments = snapshot->segments;
+    segments[0] = (Position){(int)get_u16(in + 44), (int)get_u16(in + 46)};
+    for (int i = 1; i < length; i++) {
+        Position step = direction_movement(replay_action(links, (uint32_t)(i - 1)));
+        segments[i] = (Position){segments[i - 1].x + step.x, segments[i - 1].y + step.y};
+    }
+    snapshot->state = game;
+    // restore_snapshot() and the distance field index the board with all of it
+    if (!reader->cellScratch && !(reader->cellScratch = (unsigned char *)calloc((size_t)header->width * header->height, 1))) {
+        return -1;
+    }
+    return check_snapshot(snapshot, reader->cellScratch) ? 0 : -1;
+}
+
+// Puts game, created for the replay's board, into the state it had as tick
+// was about to be stepped: the nearest keyframe at or before it, then the
+// recorded headings up to it
+int seek_replay(ReplayReader *reader, GameState *game, uint32_t tick) {
+    const ReplayHeader *header = &reader->header;
+    if (tick > header->ticks || game->width != header->width || game->height != header->height) {
+        return -1;
+    }
+    const unsigned char *index = reader->data + header->indexOffset;
+    int low = 0, high = (int)header->keyframeCount - 1, found = -1;
+    while (low <= high) {//last keyframe at or before tick
+        int middle = (low + high) / 2;
+        if (get_u32(index + middle * 8) <= tick) {
+            found = middle;
+            low = middle + 1;
+        } else {
+            high = middle - 1;
+        }
+    }
+    if (found >= 0) {
+        if (decode_keyframe(reader, get_u32(index + found * 8 + 4)) < 0) {
+            return -1;
+        }
+        restore_snapshot(game, &reader->keyframe);
+    } else {
+        game->rules = header->rules;
+        game->rng = header->seed;
+        initialize_game(game);
+    }
+    while (game->tick < tick && !game->isGameOver) {
+        steer_snake(&game->snake, direction_movement(replay_action(reader->actions, game->tick)));
+        step_game(game);
+    }
+    if (game->tick < header->ticks) {//the heading of the tick about to be stepped, as in a keyframe
+        steer_snake(&game->snake, direction_movement(replay_action(reader->actions, game->tick)));
+    }
+    return 0;
+}
+
+// Re-simulates the whole replay in game, which must be created for its board
+// and have no distance field attached if speed matters, and checks the claim.
+// The header's rules are the submitter's claim too, so anything but a named
+// variant is refused; the caller checks they are the ones its board expects.
+int verify_replay(const ReplayReader *reader, GameState *game) {
+    const ReplayHeader *header = &reader->header;
+    if (header->rulesVersion != RULES_VERSION || game->width != header->width || game->height != header->height
+        || !rules_name(&header->rules)) {
+        return REPLAY_WRONG_RULES;
+    }
+    game->rules = header->rules;
+    game->rng = header->seed;
+    initialize_game(game);
+    for (uint32_t tick = 0; tick < header->ticks; tick++) {
+        if (game->isGameOver) {
+            return REPLAY_ENDED_EARLY;
+        }
+        int direction = replay_action(reader->actions, tick);
+        steer_snake(&game->snake, direction_movement(direction));
+        if (movement_direction(game->snake.movement) != direction) {//recordings hold the heading actually taken, never a reversal
+            return REPLAY_BAD_HEADING;
+        }
+        step_game(game);
+    }
+    if (game->score != header->score || game->snake.length != header->length || game->endReason != header->endReason) {
+        return REPLAY_WRONG_RESULT;
+    }
+    return REPLAY_VALID;
+}
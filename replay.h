@@ -0,0 +1,107 @@
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include <stddef.h>
+#include "snake_engine.h"
+
+// A game stored as its starting seed, board and rules plus the heading the
+// snake took on every tick, packed four ticks to a byte. The engine is
+// deterministic, so playing the headings back reproduces the whole game.
+// Optional keyframes of the full state every few ticks let readers seek
+// without simulating from the start.
+//
+// File layout, little-endian:
+//   "SNRP" | u16 format version | u16 rules version | u16 width | u16 height
+//   u32 seed | i32 food points, bonus points, poison enabled, poison penalty,
+//   poison lifetime | u32 ticks | i32 final score, final length, end reason
+//   version 2 adds: u32 keyframe interval | u32 keyframe count | u32 index offset
+//   then ceil(ticks / 4) bytes, tick t in bits 2 * (t % 4) of byte t / 4
+//   then the keyframes, then the index: keyframe count * (u32 tick, u32 offset)
+//
+// A keyframe is the state as its tick is about to be stepped, with that
+// tick's heading already taken:
+//   u32 tick | u32 rng | i32 score, speed, foodConsumed | u8 isGameOver,
+//   endReason, heading, food flags | u16 food, bonus, poison x and y |
+//   u32 poison spawn tick | u32 length | u16 head x, y | the direction from
+//   each segment to the next, packed like the actions
+
+#define REPLAY_FORMAT_VERSION 2
+#define REPLAY_HEADER_SIZE 64
+#define REPLAY_V1_HEADER_SIZE 52
+#define KEYFRAME_FIXED_SIZE 48
+#define MAX_REPLAY_TICKS (1u << 26)  // 16 MB of actions, days of play; longer headers are refused
+
+// verify_replay() results
+enum {
+    REPLAY_VALID,
+    REPLAY_WRONG_RULES,     // another rules version, board size or rules variant
+    REPLAY_BAD_HEADING,     // a heading the snake could not have taken
+    REPLAY_ENDED_EARLY,     // the game was over before the last recorded tick
+    REPLAY_WRONG_RESULT     // the claimed score, length or end differs
+};
+
+typedef struct {
+    int formatVersion, rulesVersion;
+    int width, height;
+    uint32_t seed;          // PRNG state right before initialize_game()
+    GameRules rules;
+    uint32_t ticks;
+    int score, length, endReason;   // claimed result of the last tick
+    uint32_t keyframeInterval;      // ticks between keyframes, 0 for none
+    uint32_t keyframeCount;
+    uint32_t indexOffset;           // from the start of the file
+} ReplayHeader;
+
+typedef struct {
+    ReplayHeader header;
+    unsigned char *actions;
+    size_t capacity;
+    unsigned char *keyframes;       // encoded back to back
+    size_t keyframeBytes, keyframeCapacity;
+    uint32_t *index;                // tick, offset into keyframes, per keyframe
+    uint32_t indexCapacity;
+} ReplayWriter;
+
+// Replay files named on a command line, directories expanded
+typedef struct {
+    char **paths;
+    long count, capacity;
+} ReplayPathList;
+
+// Zero-copy view of a replay held in memory
+typedef struct {
+    ReplayHeader header;
+    const unsigned char *data;
+    size_t size;
+    const unsigned char *actions;
+    GameSnapshot keyframe;          // decoding scratch for seek_replay()
+    unsigned char *cellScratch;     // check_snapshot() scratch, one byte per cell
+} ReplayReader;
+
+int begin_replay(ReplayWriter *writer, const GameState *game, uint32_t keyframeInterval);
+int record_replay_tick(ReplayWriter *writer, const GameState *game);
+void end_replay(ReplayWriter *writer, const GameState *game);
+size_t replay_header_size(const ReplayHeader *header);
+size_t replay_size(const ReplayHeader *header);
+void write_replay_header(const ReplayHeader *header, unsigned char *out);
+size_t encoded_replay_size(const ReplayWriter *writer);
+void encode_replay(const ReplayWriter *writer, unsigned char *out);
+int save_replay(const ReplayWriter *writer, const char *path);
+uint64_t replay_hash(const unsigned char *data, size_t size);
+void free_replay_writer(ReplayWriter *writer);
+
+int read_replay_header(ReplayHeader *header, const unsigned char *data, size_t size);
+int open_replay(ReplayReader *reader, const unsigned char *data, size_t size);
+void close_replay(ReplayReader *reader);
+int load_file(const char *path, unsigned char **data, size_t *size);
+int add_replay_path(ReplayPathList *list, const char *path);
+void free_replay_paths(ReplayPathList *list);
+int start_playback(const ReplayHeader *header, GameState *game);
+int seek_replay(ReplayReader *reader, GameState *game, uint32_t tick);
+int verify_replay(const ReplayReader *reader, GameState *game);
+
+static inline int replay_action(const unsigned char *actions, uint32_t tick) {
+    return (actions[tick >> 2] >> ((tick & 3) * 2)) & 3;
+}
+
+#endif
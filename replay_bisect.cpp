@@ -0,0 +1,351 @@
+#include <SDL2/SDL.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "snake_engine.h"
+#include "replay.h"
+#include "replay_codec.h"
+#include "game_save.h"
+#include "byte_order.h"
+
+// Determinism debugging: finds the first tick where this build plays a
+// replay differently from another build, and which fields differ there.
+// States are compared by a hash of their save record (game_save.h), which
+// does not depend on how either build lays the game out in memory.
+//
+// Usage: replay_bisect [--every N] [--reference <other replay_bisect>] <replay>
+//   With --reference the other build is run alongside and streams its state
+//   hashes every N ticks (the replay's keyframe interval, or 1000). The
+//   window where they first differ is bisected down to one tick, then the
+//   other build's state there is saved and compared field by field.
+//   Without it the reference is the replay's own keyframes, as written by
+//   the build that recorded it; the first keyframe that differs is reported.
+// The reference side answers: --hashes <replay> <every>, --hash <replay>
+// <tick> and --state <replay> <tick> <save file>.
+// The state at a tick is the one about to be stepped, that tick's heading
+// taken, as in a keyframe. Exits 1 on a divergence and 2 when the reference
+// fails, so a crashing build is never reported as matching.
+
+#ifdef _WIN32
+#define popen _popen
+#define pclose _pclose
+#endif
+
+#define REFERENCE_STATE_PATH "replay_bisect_reference.sav"
+#define REFERENCE_FAILED 2      // exit code when the reference crashed or stopped early
+
+typedef struct {
+    const ReplayReader *replay;
+    GameState game;
+    unsigned char *record;      // write_saved_game() scratch for hashing
+    size_t recordCapacity;
+} Playback;
+
+static void steer_current(Playback *playback) {
+    if (playback->game.tick < playback->replay->header.ticks) {
+        steer_snake(&playback->game.snake, direction_movement(replay_action(playback->replay->actions, playback->game.tick)));
+    }
+}
+
+static int start_replay(Playback *playback, const ReplayReader *replay) {
+    memset(playback, 0, sizeof(*playback));
+    playback->replay = replay;
+    if (start_playback(&replay->header, &playback->game) < 0) {
+        return -1;
+    }
+    steer_current(playback);
+    return 0;
+}
+
+static void play_to(Playback *playback, uint32_t tick) {
+    while (playback->game.tick < tick && !playback->game.isGameOver) {
+        step_game(&playback->game);
+        steer_current(playback);
+    }
+}
+
+static uint64_t state_hash(Playback *playback, const GameState *game) {
+    size_t size = saved_game_size(game);
+    if (size > playback->recordCapacity) {
+        unsigned char *grown = (unsigned char *)realloc(playback->record, size);
+        if (!grown) {
+            return 0;
+        }
+        playback->record = grown;
+        playback->recordCapacity = size;
+    }
+    write_saved_game(game, playback->record);
+    return replay_hash(playback->record, size);
+}
+
+static void end_replay_playback(Playback *playback) {
+    free(playback->record);
+    destroy_game(&playback->game);
+}
+
+static void compare_field(const char *name, long long ours, long long theirs) {
+    if (ours != theirs) {
+        printf("  %-20s %lld here, %lld in the reference\n", name, ours, theirs);
+    }
+}
+
+static void print_differences(const GameState *ours, const GameState *theirs) {
+    compare_field("tick", ours->tick, theirs->tick);
+    compare_field("rng", ours->rng, theirs->rng);
+    compare_field("score", ours->score, theirs->score);
+    compare_field("speed", ours->speed, theirs->speed);
+    compare_field("foodConsumed", ours->foodConsumed, theirs->foodConsumed);
+    compare_field("isGameOver", ours->isGameOver, theirs->isGameOver);
+    compare_field("endReason", ours->endReason, theirs->endReason);
+    compare_field("snake.length", ours->snake.length, theirs->snake.length);
+    compare_field("snake.movement.x", ours->snake.movement.x, theirs->snake.movement.x);
+    compare_field("snake.movement.y", ours->snake.movement.y, theirs->snake.movement.y);
+    compare_field("food.location.x", ours->food.location.x, theirs->food.location.x);
+    compare_field("food.location.y", ours->food.location.y, theirs->food.location.y);
+    compare_field("food.isActive", ours->food.isActive, theirs->food.isActive);
+    compare_field("bonus.location.x", ours->bonus.location.x, theirs->bonus.location.x);
+    compare_field("bonus.location.y", ours->bonus.location.y, theirs->bonus.location.y);
+    compare_field("bonus.isActive", ours->bonus.isActive, theirs->bonus.isActive);
+    compare_field("poison.location.x", ours->poison.location.x, theirs->poison.location.x);
+    compare_field("poison.location.y", ours->poison.location.y, theirs->poison.location.y);
+    compare_field("poison.isActive", ours->poison.isActive, theirs->poison.isActive);
+    compare_field("poison.spawnTick", ours->poison.spawnTick, theirs->poison.spawnTick);
+    int length = ours->snake.length < theirs->snake.length ? ours->snake.length : theirs->snake.length;
+    for (int i = 0; i < length; i++) {//the first segment apart is enough, the rest usually follow it
+        Position a = snake_segment(&ours->snake, i), b = snake_segment(&theirs->snake, i);
+        if (a.x != b.x || a.y != b.y) {
+            printf("  segment %-12d (%d, %d) here, (%d, %d) in the reference\n", i, a.x, a.y, b.x, b.y);
+            break;
+        }
+    }
+}
+
+// Runs the reference build with arguments and reads the first line it prints
+static FILE *run_reference(const char *reference, const char *arguments) {
+    char command[2048];
+#ifdef _WIN32
+    snprintf(command, sizeof(command), "\"\"%s\" %s\"", reference, arguments);//cmd /c strips the outer quotes
+#else
+    snprintf(command, sizeof(command), "\"%s\" %s", reference, arguments);
+#endif
+    return popen(command, "r");
+}
+
+static int reference_hash(const char *reference, const char *replayPath, uint32_t tick, uint64_t *hash) {
+    char arguments[1200];
+    snprintf(arguments, sizeof(arguments), "--hash \"%s\" %u", replayPath, tick);
+    FILE *pipe = run_reference(reference, arguments);
+    if (!pipe) {
+        return -1;
+    }
+    unsigned int answeredTick;
+    unsigned long long value;
+    int ok = fscanf(pipe, "%u %llx", &answeredTick, &value) == 2 && answeredTick == tick;
+    ok = pclose(pipe) == 0 && ok;//a reference that crashed after printing is no answer
+    if (ok) *hash = value;
+    return ok ? 0 : -1;
+}
+
+// Lockstep with the reference's hash stream, then bisection of the first
+// window that differs. Returns 0 without a divergence, 1 with one and
+// REFERENCE_FAILED when the reference did not answer for the whole replay.
+static int bisect_against_reference(const ReplayReader *replay, const char *replayPath, const char *reference, uint32_t every) {
+    Playback local;
+    GameSnapshot matched = {};
+    if (start_replay(&local, replay) < 0) {
+        printf("Cannot play the replay in this build\n");
+        return 1;
+    }
+    char arguments[1200];
+    snprintf(arguments, sizeof(arguments), "--hashes \"%s\" %u", replayPath, every);
+    FILE *pipe = run_reference(reference, arguments);
+    if (!pipe) {
+        printf("Cannot run %s\n", reference);
+        return 1;
+    }
+    uint32_t low = 0, high = 0, compared = 0, last = 0;
+    int diverged = 0;
+    unsigned int tick;
+    unsigned long long hash;
+    while (!diverged && fscanf(pipe, "%u %llx", &tick, &hash) == 2) {
+        play_to(&local, tick);
+        if (state_hash(&local, &local.game) == hash) {
+            low = tick;
+            save_snapshot(&matched, &local.game);
+        } else {
+            high = tick;
+            diverged = 1;
+        }
+        last = tick;
+        compared++;
+    }
+    int status = pclose(pipe);//leaving early may stop it with a broken pipe, which is only an error without a divergence
+    if (!diverged && (status != 0 || compared == 0 || last != replay->header.ticks)) {
+        printf("The reference failed after %u states, the last at tick %u of %u\n", compared, last, replay->header.ticks);
+        end_replay_playback(&local);
+        free_snapshot(&matched);
+        return REFERENCE_FAILED;
+    }
+    if (diverged && !matched.segments) {
+        printf("The starting states already differ, check the rules version\n");
+        end_replay_playback(&local);
+        free_snapshot(&matched);
+        return 1;
+    }
+    if (!diverged) {
+        printf("No divergence over %u ticks, %u states compared\n", replay->header.ticks, compared);
+        end_replay_playback(&local);
+        free_snapshot(&matched);
+        return 0;
+    }
+    printf("Same at tick %u, different at tick %u; bisecting\n", low, high);
+    int failed = 0;
+    while (high - low > 1 && !failed) {//low always matches and high never does
+        uint32_t middle = low + (high - low) / 2;
+        restore_snapshot(&local.game, &matched);
+        play_to(&local, middle);
+        uint64_t theirs;
+        failed = reference_hash(reference, replayPath, middle, &theirs) < 0;
+        if (failed) break;//high stays the last tick shown to differ
+        if (state_hash(&local, &local.game) == theirs) {
+            low = middle;
+            save_snapshot(&matched, &local.game);
+        } else {
+            high = middle;
+        }
+    }
+    restore_snapshot(&local.game, &matched);
+    play_to(&local, high);
+    snprintf(arguments, sizeof(arguments), "--state \"%s\" %u \"%s\"", replayPath, high, REFERENCE_STATE_PATH);
+    pipe = failed ? NULL : run_reference(reference, arguments);
+    GameState theirs = {};
+    if (!pipe || pclose(pipe) != 0 || create_game(&theirs, replay->header.width, replay->header.height, 1) < 0
+        || load_game(REFERENCE_STATE_PATH, &theirs) < 0) {
+        printf("The reference did not answer, divergence between ticks %u and %u\n", low, high);
+    } else {
+        printf("First divergence stepping tick %u, the state at tick %u differs in:\n", low, high);
+        print_differences(&local.game, &theirs);
+    }
+    remove(REFERENCE_STATE_PATH);
+    destroy_game(&theirs);
+    free_snapshot(&matched);
+    end_replay_playback(&local);
+    return 1;
+}
+
+// Checks this build's playback against every keyframe stored in the replay
+static int compare_keyframes(ReplayReader *replay) {
+    const ReplayHeader *header = &replay->header;
+    Playback local;
+    GameState keyframe;
+    if (start_replay(&local, replay) < 0 || create_game(&keyframe, header->width, header->height, 1) < 0) {
+        printf("Cannot play the replay in this build\n");
+        return 1;
+    }
+    const unsigned char *index = replay->data + header->indexOffset;
+    uint32_t previous = 0;
+    int result = 0;
+    for (uint32_t k = 0; k < header->keyframeCount; k++) {
+        uint32_t tick = get_u32(index + k * 8);
+        play_to(&local, tick);
+        if (seek_replay(replay, &keyframe, tick) < 0) {
+            printf("Keyframe %u is corrupt\n", k);
+            result = 1;
+            break;
+        }
+        if (state_hash(&local, &local.game) != state_hash(&local, &keyframe)) {
+            printf("Same at tick %u, keyframe at tick %u differs in:\n", previous, tick);
+            print_differences(&local.game, &keyframe);
+            printf("Run the recording build with --reference to find the exact tick\n");
+            result = 1;
+            break;
+        }
+        previous = tick;
+    }
+    if (!result) {
+        printf("No divergence at any of %u keyframes\n", header->keyframeCount);
+    }
+    destroy_game(&keyframe);
+    end_replay_playback(&local);
+    return result;
+}
+
+// The reference side, run by the other build
+static int answer(const char *mode, const ReplayReader *replay, int argc, char *argv[]) {
+    Playback playback;
+    if (start_replay(&playback, replay) < 0) {
+        return 1;
+    }
+    int result = 0;
+    if (strcmp(mode, "--hashes") == 0 && argc >= 1) {
+        uint32_t every = (uint32_t)strtoul(argv[0], NULL, 10);
+        if (every == 0) every = 1000;
+        uint32_t tick = 0;
+        for (;;) {//the last tick is always included
+            play_to(&playback, tick);
+            printf("%u %016llx\n", tick, (unsigned long long)state_hash(&playback, &playback.game));
+            if (tick == replay->header.ticks) break;
+            tick = replay->header.ticks - tick > every ? tick + every : replay->header.ticks;
+        }
+    } else if (strcmp(mode, "--hash") == 0 && argc >= 1) {
+        uint32_t tick = (uint32_t)strtoul(argv[0], NULL, 10);
+        play_to(&playback, tick);
+        printf("%u %016llx\n", tick, (unsigned long long)state_hash(&playback, &playback.game));
+    } else if (strcmp(mode, "--state") == 0 && argc >= 2) {
+        play_to(&playback, (uint32_t)strtoul(argv[0], NULL, 10));
+        result = save_games(argv[1], &playback.game, 1) < 0;
+    } else {
+        result = 1;
+    }
+    end_replay_playback(&playback);
+    return result;
+}
+
+int main(int argc, char *argv[]) {
+    const char *reference = NULL, *replayPath = NULL, *mode = NULL;
+    uint32_t every = 0;
+    int first = 1;
+    if (argc > 2 && (strcmp(argv[1], "--hashes") == 0 || strcmp(argv[1], "--hash") == 0 || strcmp(argv[1], "--state") == 0)) {
+        mode = argv[1];
+        replayPath = argv[2];
+        first = argc;
+    }
+    for (int i = first; i < argc; i++) {
+        if (strcmp(argv[i], "--every") == 0 && i + 1 < argc) {
+            every = (uint32_t)strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--reference") == 0 && i + 1 < argc) {
+            reference = argv[++i];
+        } else if (argv[i][0] != '-' && !replayPath) {
+            replayPath = argv[i];
+        } else {
+            printf("Unknown option: %s\n", argv[i]);
+            return 1;
+        }
+    }
+    if (!replayPath) {
+        printf("Usage: %s [--every N] [--reference <other replay_bisect>] <replay>\n", argv[0]);
+        return 1;
+    }
+    unsigned char *data = NULL;
+    size_t size = 0;
+    ReplayReader replay;
+    if (load_replay_file(replayPath, &data, &size) < 0 || open_replay(&replay, data, size) < 0) {
+        printf("Cannot read replay %s\n", replayPath);
+        return 1;
+    }
+    int result;
+    if (mode) {
+        result = answer(mode, &replay, argc - 3, argv + 3);
+    } else if (reference) {
+        if (!every) every = replay.header.keyframeInterval ? replay.header.keyframeInterval : 1000;
+        result = bisect_against_reference(&replay, replayPath, reference, every);
+    } else if (replay.header.keyframeCount) {
+        result = compare_keyframes(&replay);
+    } else {
+        printf("The replay has no keyframes, give the other build with --reference\n");
+        result = 1;
+    }
+    close_replay(&replay);
+    free(data);
+    return result;
+}
@@ -0,0 +1,342 @@
+#include "replay_codec.h"
+#include "byte_order.h"
+#include <stdlib.h>
+#include <string.h>
+
+// Binary range coder with 11-bit probabilities, as in LZMA
+#define PROBABILITY_BITS 11
+#define PROBABILITY_ONE (1u << PROBABILITY_BITS)
+#define ADAPT_SHIFT 4    // faster than LZMA's 5, most replays are only a few thousand runs
+#define RANGE_TOP (1u << 24)
+
+// Headings in clockwise order, so a turn is a rotation: 0 right, 1 reversal, 2 left
+static const int clockwise[4] = {0, 2, 3, 1};
+static const int fromClockwise[4] = {0, 3, 1, 2};
+
+typedef struct {
+    unsigned char *out;
+    size_t size, capacity;
+    uint64_t low;
+    uint32_t range;
+    unsigned char cache;
+    uint64_t pending;       // the cache and any 0xff bytes after it, held back for a carry
+    int failed;
+} RangeEncoder;
+
+static void init_model(RunModel *model) {
+    uint16_t *probabilities = (uint16_t *)model;
+    for (size_t i = 0; i < sizeof(*model) / sizeof(uint16_t); i++) {
+        probabilities[i] = PROBABILITY_ONE / 2;
+    }
+}
+
+static void put_byte(RangeEncoder *encoder, unsigned char byte) {
+    if (encoder->size == encoder->capacity) {
+        unsigned char *grown = (unsigned char *)realloc(encoder->out, encoder->capacity * 2);
+        if (!grown) {
+            encoder->failed = 1;
+            return;
+        }
+        encoder->out = grown;
+        encoder->capacity *= 2;
+    }
+    encoder->out[encoder->size++] = byte;
+}
+
+static void shift_low(RangeEncoder *encoder) {
+    if ((uint32_t)encoder->low < 0xff000000u || (encoder->low >> 32) != 0) {
+        unsigned char carry = (unsigned char)(encoder->low >> 32);
+        unsigned char byte = encoder->cache;
+        do {
+            put_byte(encoder, (unsigned char)(byte + carry));
+            byte = 0xff;
+        } while (--encoder->pending);
+        encoder->cache = (unsigned char)(encoder->low >> 24);
+    }
+    encoder->pending++;
+    encoder->low = (encoder->low & 0x00ffffffu) << 8;
+}
+
+static void encode_bit(RangeEncoder *encoder, uint16_t *probability, int bit) {
+    uint32_t bound = (encoder->range >> PROBABILITY_BITS) * *probability;
+    if (bit) {
+        encoder->low += bound;
+        encoder->range -= bound;
+        *probability -= *probability >> ADAPT_SHIFT;
+    } else {
+        encoder->range = bound;
+        *probability += (PROBABILITY_ONE - *probability) >> ADAPT_SHIFT;
+    }
+    if (encoder->range < RANGE_TOP) {
+        encoder->range <<= 8;
+        shift_low(encoder);
+    }
+}
+
+static void encode_direct(RangeEncoder *encoder, int bit) {
+    encoder->range >>= 1;
+    if (bit) encoder->low += encoder->range;
+    if (encoder->range < RANGE_TOP) {
+        encoder->range <<= 8;
+        shift_low(encoder);
+    }
+}
+
+// Most significant bit first, each under the probability of the bits above it
+static void encode_tree(RangeEncoder *encoder, uint16_t *probabilities, int bits, uint32_t value) {
+    uint32_t node = 1;
+    for (int i = bits - 1; i >= 0; i--) {
+        int bit = (value >> i) & 1;
+        encode_bit(encoder, &probabilities[node], bit);
+        node = node << 1 | bit;
+    }
+}
+
+static int leading_bit(uint32_t value) {
+    int position = 0;
+    while (value >>= 1) position++;
+    return position;
+}
+
+static void encode_run(RangeEncoder *encoder, RunModel *model, int *bucket, uint32_t run) {
+    int position = leading_bit(run);
+    int modelled = position < RUN_MODELLED_BITS ? position : RUN_MODELLED_BITS;
+    int low = position - modelled;
+    encode_tree(encoder, model->bucket[*bucket], 5, (uint32_t)position);
+    encode_tree(encoder, model->mantissa[position], modelled, (run >> low) & ((1u << modelled) - 1));
+    for (int i = low - 1; i >= 0; i--) {
+        encode_direct(encoder, (run >> i) & 1);
+    }
+    *bucket = position;
+}
+
+static void encode_actions(RangeEncoder *encoder, RunModel *model, const unsigned char *actions, uint32_t ticks) {
+    if (ticks == 0) {
+        return;
+    }
+    int direction = replay_action(actions, 0);
+    int bucket = 0, turns = 15;
+    encode_tree(encoder, model->first, 2, (uint32_t)direction);
+    uint32_t tick = 0;
+    while (tick < ticks) {
+        uint32_t run = 1;
+        while (tick + run < ticks && replay_action(actions, tick + run) == direction) run++;
+        encode_run(encoder, model, &bucket, run);
+        tick += run;
+        if (tick < ticks) {
+            int next = replay_action(actions, tick);
+            int turn = ((clockwise[next] - clockwise[direction]) & 3) - 1;
+            encode_tree(encoder, model->turn[turns], 2, (uint32_t)turn);
+            turns = (turns << 2 | turn) & 15;
+            direction = next;
+        }
+    }
+}
+
+int is_compressed_replay(const unsigned char *data, size_t size) {
+    return size >= 4 && memcmp(data, "SNRZ", 4) == 0;
+}
+
+// Compresses a replay file image into a new buffer the caller frees
+int compress_replay(const unsigned char *data, size_t size, unsigned char **out, size_t *outSize) {
+    ReplayReader reader;
+    if (open_replay(&reader, data, size) < 0) {
+        return -1;
+    }
+    const ReplayHeader *header = &reader.header;
+    size_t headerBytes = replay_header_size(header);
+    size_t actionsEnd = headerBytes + ((size_t)header->ticks + 3) / 4;
+    size_t restBytes = size - actionsEnd;
+    RangeEncoder encoder = {};
+    encoder.capacity = COMPRESSED_HEADER_SIZE + headerBytes + header->ticks / 32 + restBytes + 64;
+    encoder.out = (unsigned char *)malloc(encoder.capacity);
+    encoder.range = 0xffffffffu;
+    encoder.pending = 1;
+    RunModel *model = (RunModel *)malloc(sizeof(RunModel));
+    if (!encoder.out || !model || size > 0xffffffffu) {
+        free(encoder.out);
+        free(model);
+        return -1;
+    }
+    init_model(model);
+    encoder.size = COMPRESSED_HEADER_SIZE + headerBytes;
+    encode_actions(&encoder, model, reader.actions, header->ticks);
+    for (int i = 0; i < 5; i++) shift_low(&encoder);
+    size_t codedBytes = encoder.size - COMPRESSED_HEADER_SIZE - headerBytes;
+    for (size_t i = 0; i < restBytes; i++) put_byte(&encoder, data[actionsEnd + i]);
+    free(model);
+    if (encoder.failed || codedBytes > 0xffffffffu) {
+        free(encoder.out);
+        return -1;
+    }
+    memcpy(encoder.out, "SNRZ", 4);
+    put_u16(encoder.out + 4, REPLAY_CODEC_VERSION);
+    put_u16(encoder.out + 6, 0);
+    put_u32(encoder.out + 8, (uint32_t)size);
+    put_u32(encoder.out + 12, (uint32_t)codedBytes);
+    memcpy(encoder.out + COMPRESSED_HEADER_SIZE, data, headerBytes);
+    *out = encoder.out;
+    *outSize = encoder.size;
+    return 0;
+}
+
+static unsigned char next_byte(ActionDecoder *decoder) {
+    return decoder->in < decoder->end ? *decoder->in++ : 0;
+}
+
+static int decode_bit(ActionDecoder *decoder, uint16_t *probability) {
+    uint32_t bound = (decoder->range >> PROBABILITY_BITS) * *probability;
+    int bit;
+    if (decoder->code < bound) {
+        decoder->range = bound;
+        *probability += (PROBABILITY_ONE - *probability) >> ADAPT_SHIFT;
+        bit = 0;
+    } else {
+        decoder->code -= bound;
+        decoder->range -= bound;
+        *probability -= *probability >> ADAPT_SHIFT;
+        bit = 1;
+    }
+    if (decoder->range < RANGE_TOP) {
+        decoder->range <<= 8;
+        decoder->code = decoder->code << 8 | next_byte(decoder);
+    }
+    return bit;
+}
+
+static int decode_direct(ActionDecoder *decoder) {
+    decoder->range >>= 1;
+    int bit = decoder->code >= decoder->range;
+    if (bit) decoder->code -= decoder->range;
+    if (decoder->range < RANGE_TOP) {
+        decoder->range <<= 8;
+        decoder->code = decoder->code << 8 | next_byte(decoder);
+    }
+    return bit;
+}
+
+static uint32_t decode_tree(ActionDecoder *decoder, uint16_t *probabilities, int bits) {
+    uint32_t node = 1;
+    for (int i = 0; i < bits; i++) {
+        node = node << 1 | (uint32_t)decode_bit(decoder, &probabilities[node]);
+    }
+    return node - (1u << bits);
+}
+
+static uint32_t decode_run(ActionDecoder *decoder) {
+    int position = (int)decode_tree(decoder, decoder->model.bucket[decoder->bucket], 5);
+    int modelled = position < RUN_MODELLED_BITS ? position : RUN_MODELLED_BITS;
+    uint32_t run = 1u << modelled | decode_tree(decoder, decoder->model.mantissa[position], modelled);
+    for (int i = modelled; i < position; i++) {
+        run = run << 1 | (uint32_t)decode_direct(decoder);
+    }
+    decoder->bucket = position;
+    return run;
+}
+
+// Reads the header of a compressed replay and readies its headings; data
+// must outlive the decoder
+int open_action_decoder(ActionDecoder *decoder, const unsigned char *data, size_t size) {
+    memset(decoder, 0, sizeof(*decoder));
+    if (size < COMPRESSED_HEADER_SIZE || !is_compressed_replay(data, size) || get_u16(data + 4) != REPLAY_CODEC_VERSION
+        || read_replay_header(&decoder->header, data + COMPRESSED_HEADER_SIZE, size - COMPRESSED_HEADER_SIZE) < 0) {
+        return -1;
+    }
+    size_t start = COMPRESSED_HEADER_SIZE + replay_header_size(&decoder->header);
+    size_t codedBytes = get_u32(data + 12);
+    // Zero bytes decode as endless runs, so a tiny file could claim any
+    // number of ticks; a claim out of all proportion to the file is refused
+    if (start + codedBytes > size || ((size_t)decoder->header.ticks + 3) / 4 > (size_t)MAX_REPLAY_EXPANSION * size) {
+        return -1;
+    }
+    decoder->in = data + start;
+    decoder->end = decoder->in + codedBytes;
+    decoder->range = 0xffffffffu;
+    for (int i = 0; i < 5; i++) {
+        decoder->code = decoder->code << 8 | next_byte(decoder);
+    }
+    init_model(&decoder->model);
+    decoder->turns = 15;
+    if (decoder->header.ticks) {
+        decoder->direction = (int)decode_tree(decoder, decoder->model.first, 2);
+    }
+    return 0;
+}
+
+// The heading of the next tick; past the last tick the last heading repeats
+int next_replay_action(ActionDecoder *decoder) {
+    if (decoder->runLeft == 0) {
+        if (decoder->tick >= decoder->header.ticks) {
+            return decoder->direction;
+        }
+        if (decoder->tick > 0) {
+            int turn = (int)decode_tree(decoder, decoder->model.turn[decoder->turns], 2);
+            decoder->failed |= turn == 3;//never written
+            decoder->turns = (decoder->turns << 2 | turn) & 15;
+            decoder->direction = fromClockwise[(clockwise[decoder->direction] + turn + 1) & 3];
+        }
+        uint32_t run = decode_run(decoder);
+        if (run > decoder->header.ticks - decoder->tick) {
+            decoder->failed = 1;
+            run = decoder->header.ticks - decoder->tick;
+        }
+        decoder->runLeft = run;
+    }
+    decoder->runLeft--;
+    decoder->tick++;
+    return decoder->direction;
+}
+
+// Rebuilds the original file image into a new buffer the caller frees; the
+// decoder has already refused images out of proportion to data
+int expand_replay(const unsigned char *data, size_t size, unsigned char **out, size_t *outSize) {
+    ActionDecoder *decoder = (ActionDecoder *)malloc(sizeof(ActionDecoder));
+    if (!decoder || open_action_decoder(decoder, data, size) < 0) {
+        free(decoder);
+        return -1;
+    }
+    const ReplayHeader *header = &decoder->header;
+    size_t headerBytes = replay_header_size(header);
+    size_t actionBytes = ((size_t)header->ticks + 3) / 4;
+    size_t restStart = (size_t)(decoder->end - data);
+    size_t expanded = get_u32(data + 8);
+    unsigned char *image = expanded == headerBytes + actionBytes + (size - restStart) ? (unsigned char *)malloc(expanded) : NULL;
+    if (!image) {
+        free(decoder);
+        return -1;
+    }
+    memcpy(image, data + COMPRESSED_HEADER_SIZE, headerBytes);
+    unsigned char *actions = image + headerBytes;
+    memset(actions, 0, actionBytes);
+    for (uint32_t tick = 0; tick < header->ticks; tick++) {
+        actions[tick >> 2] |= (unsigned char)(next_replay_action(decoder) << ((tick & 3) * 2));
+    }
+    memcpy(actions + actionBytes, data + restStart, size - restStart);
+    int failed = decoder->failed;
+    free(decoder);
+    ReplayReader reader;
+    if (failed || open_replay(&reader, image, expanded) < 0) {
+        free(image);
+        return -1;
+    }
+    *out = image;
+    *outSize = expanded;
+    return 0;
+}
+
+// load_file() for replays stored either way, always giving the plain image
+int load_replay_file(const char *path, unsigned char **data, size_t *size) {
+    if (load_file(path, data, size) < 0) {
+        return -1;
+    }
+    if (!is_compressed_replay(*data, *size)) {
+        return 0;
+    }
+    unsigned char *expanded;
+    size_t expandedSize;
+    int result = expand_replay(*data, *size, &expanded, &expandedSize);
+    free(*data);
+    *data = result == 0 ? expanded : NULL;
+    *size = result == 0 ? expandedSize : 0;
+    return result;
+}
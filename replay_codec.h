@@ -0,0 +1,56 @@
+#ifndef REPLAY_CODEC_H
+#define REPLAY_CODEC_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "replay.h"
+
+// Compressed replays for archiving. Most ticks repeat the previous heading,
+// so the actions are stored as runs: the first heading, then per run its
+// length and the turn that ends it, through an adaptive binary range coder.
+// Everything else in the replay is kept byte for byte, so expanding gives
+// back the exact file image and its replay_hash().
+//
+// File layout, little-endian:
+//   "SNRZ" | u16 codec version | u16 reserved | u32 expanded size |
+//   u32 coded actions size | the replay header as stored | coded actions |
+//   the keyframes and index that followed the actions, unchanged
+//
+// Run lengths are coded as the position of their leading one bit, in the
+// context of the previous run's, then the next bits below it in the context
+// of that position and any lower bits at even odds. A turn is the new heading
+// minus the old one, in the context of the two turns before it.
+
+#define REPLAY_CODEC_VERSION 1
+#define COMPRESSED_HEADER_SIZE 16
+#define RUN_BUCKETS 32          // leading bit positions of a u32 run length
+#define RUN_MODELLED_BITS 6     // bits below the leading one with their own model
+#define MAX_REPLAY_EXPANSION 256    // real games code 7-20x smaller; claims beyond this are refused unread
+
+typedef struct {
+    uint16_t first[4];
+    uint16_t bucket[RUN_BUCKETS][RUN_BUCKETS];
+    uint16_t mantissa[RUN_BUCKETS][1 << RUN_MODELLED_BITS];
+    uint16_t turn[16][4];
+} RunModel;
+
+// Streams the headings of a compressed replay one tick at a time
+typedef struct {
+    ReplayHeader header;
+    const unsigned char *in, *end;
+    uint32_t range, code;
+    RunModel model;
+    uint32_t tick, runLeft;
+    int direction, bucket, turns;   // turns holds the last two, 3 for none yet
+    int failed;                     // a run past the last tick
+} ActionDecoder;
+
+int is_compressed_replay(const unsigned char *data, size_t size);
+int compress_replay(const unsigned char *data, size_t size, unsigned char **out, size_t *outSize);
+int expand_replay(const unsigned char *data, size_t size, unsigned char **out, size_t *outSize);
+int load_replay_file(const char *path, unsigned char **data, size_t *size);
+
+int open_action_decoder(ActionDecoder *decoder, const unsigned char *data, size_t size);
+int next_replay_action(ActionDecoder *decoder);
+
+#endif
@@ -0,0 +1,249 @@
+#include "replay_corpus.h"
+#include "replay_codec.h"
+#include "byte_order.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+void unmap_file(MappedFile *mapped) {
+#ifdef _WIN32
+    if (mapped->data) UnmapViewOfFile(mapped->data);
+    if (mapped->mapping) CloseHandle((HANDLE)mapped->mapping);
+    if (mapped->file) CloseHandle((HANDLE)mapped->file);
+#else
+    if (mapped->data) munmap((void *)mapped->data, mapped->size);
+#endif
+    memset(mapped, 0, sizeof(*mapped));
+}
+
+// Read-only mapping of a whole file; an empty file maps to data == NULL
+int map_file(MappedFile *mapped, const char *path) {
+    memset(mapped, 0, sizeof(*mapped));
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    LARGE_INTEGER size;
+    if (file == INVALID_HANDLE_VALUE) {
+        return -1;
+    }
+    if (!GetFileSizeEx(file, &size)) {
+        CloseHandle(file);
+        return -1;
+    }
+    mapped->file = file;
+    mapped->size = (size_t)size.QuadPart;
+    if (mapped->size == 0) {
+        return 0;
+    }
+    HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    mapped->mapping = mapping;
+    mapped->data = mapping ? (const unsigned char *)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : NULL;
+#else
+    int file = open(path, O_RDONLY);
+    struct stat status;
+    if (file < 0) {
+        return -1;
+    }
+    if (fstat(file, &status) < 0) {
+        close(file);
+        return -1;
+    }
+    mapped->size = (size_t)status.st_size;
+    if (mapped->size == 0) {
+        close(file);
+        return 0;
+    }
+    void *data = mmap(NULL, mapped->size, PROT_READ, MAP_PRIVATE, file, 0);
+    close(file);//the mapping keeps the file open
+    mapped->data = data == MAP_FAILED ? NULL : (const unsigned char *)data;
+#endif
+    if (!mapped->data) {
+        unmap_file(mapped);
+        return -1;
+    }
+    return 0;
+}
+
+// Asks the OS to start reading the pages in so they are resident by the time
+// they are touched. Without an OS hint only the first cache lines are fetched.
+static void prefetch_range(const MappedFile *mapped, size_t offset, size_t size) {
+    if (size == 0) {
+        return;
+    }
+#ifndef _WIN32
+    long page = sysconf(_SC_PAGESIZE);
+    size_t start = offset - offset % (size_t)page;
+    madvise((void *)(mapped->data + start), offset + size - start, MADV_WILLNEED);
+#endif
+    for (size_t line = 0; line < size && line < 256; line += 64) {
+        __builtin_prefetch(mapped->data + offset + line);
+    }
+}
+
+void put_corpus_entry(unsigned char *entry, uint64_t offset, uint32_t size, uint32_t ticks) {
+    put_u64(entry, offset);
+    put_u32(entry + 8, size);
+    put_u32(entry + 12, ticks);
+}
+
+// Writes the index for count entries laid out by put_corpus_entry()
+int write_corpus_index(const char *indexPath, const unsigned char *entries, uint64_t count) {
+    FILE *index = fopen(indexPath, "wb");
+    if (!index) {
+        return -1;
+    }
+    unsigned char header[CORPUS_INDEX_HEADER_SIZE];
+    memcpy(header, "SNCI", 4);
+    put_u32(header + 4, CORPUS_INDEX_VERSION);
+    put_u64(header + 8, count);
+    int ok = fwrite(header, 1, sizeof(header), index) == sizeof(header)
+          && fwrite(entries, CORPUS_INDEX_ENTRY_SIZE, count, index) == count;
+    return fclose(index) == 0 && ok ? 0 : -1;
+}
+
+// Concatenates the readable replays among paths; the others are counted in skipped
+int build_replay_corpus(const char *corpusPath, const char *indexPath, char *const *paths, long count, long *skipped) {
+    FILE *corpus = fopen(corpusPath, "wb");
+    unsigned char *entries = (unsigned char *)malloc((size_t)(count ? count : 1) * CORPUS_INDEX_ENTRY_SIZE);
+    if (!corpus || !entries) {
+        if (corpus) fclose(corpus);
+        free(entries);
+        return -1;
+    }
+    uint64_t offset = 0, written = 0;
+    int ok = 1;
+    *skipped = 0;
+    for (long i = 0; i < count && ok; i++) {
+        unsigned char *data;
+        size_t size;
+        ReplayReader reader;
+        if (load_replay_file(paths[i], &data, &size) < 0) {//compressed replays are stored expanded, for zero-copy reads
+            (*skipped)++;
+            continue;
+        }
+        if (open_replay(&reader, data, size) < 0 || size > 0xffffffffu) {
+            (*skipped)++;
+            free(data);
+            continue;
+        }
+        put_corpus_entry(entries + written * CORPUS_INDEX_ENTRY_SIZE, offset, (uint32_t)size, reader.header.ticks);
+        ok = fwrite(data, 1, size, corpus) == size;
+        offset += size;
+        written++;
+        close_replay(&reader);
+        free(data);
+    }
+    ok = fclose(corpus) == 0 && ok;
+    ok = ok && write_corpus_index(indexPath, entries, written) == 0;
+    free(entries);
+    return ok ? 0 : -1;
+}
+
+// Checks the index against the corpus once, so corpus_replay() can trust it
+int open_replay_corpus(ReplayCorpus *corpus, const char *corpusPath, const char *indexPath) {
+    memset(corpus, 0, sizeof(*corpus));
+    if (map_file(&corpus->index, indexPath) < 0) {
+        return -1;
+    }
+    if (map_file(&corpus->corpus, corpusPath) < 0) {
+        unmap_file(&corpus->index);
+        return -1;
+    }
+    const unsigned char *index = corpus->index.data;
+    int ok = corpus->index.size >= CORPUS_INDEX_HEADER_SIZE && memcmp(index, "SNCI", 4) == 0
+          && get_u32(index + 4) == CORPUS_INDEX_VERSION;
+    if (ok) {
+        corpus->count = get_u64(index + 8);
+        ok = corpus->count <= (corpus->index.size - CORPUS_INDEX_HEADER_SIZE) / CORPUS_INDEX_ENTRY_SIZE;
+    }
+    for (uint64_t i = 0; ok && i < corpus->count; i++) {
+        const unsigned char *entry = index + CORPUS_INDEX_HEADER_SIZE + i * CORPUS_INDEX_ENTRY_SIZE;
+        uint64_t offset = get_u64(entry);
+        ok = offset <= corpus->corpus.size && get_u32(entry + 8) <= corpus->corpus.size - offset;
+        corpus->ticks += get_u32(entry + 12);
+    }
+    if (!ok) {
+        close_replay_corpus(corpus);
+        return -1;
+    }
+    return 0;
+}
+
+void close_replay_corpus(ReplayCorpus *corpus) {
+    unmap_file(&corpus->corpus);
+    unmap_file(&corpus->index);
+    corpus->count = 0;
+}
+
+// The reader points straight into the mapping and needs no close_replay()
+// unless it is used to seek
+int corpus_replay(const ReplayCorpus *corpus, uint64_t n, ReplayReader *reader) {
+    if (n >= corpus->count) {
+        return -1;
+    }
+    const unsigned char *entry = corpus->index.data + CORPUS_INDEX_HEADER_SIZE + n * CORPUS_INDEX_ENTRY_SIZE;
+    return open_replay(reader, corpus->corpus.data + get_u64(entry), get_u32(entry + 8));
+}
+
+void prefetch_corpus_replay(const ReplayCorpus *corpus, uint64_t n) {
+    if (n >= corpus->count) {
+        return;
+    }
+    const unsigned char *entry = corpus->index.data + CORPUS_INDEX_HEADER_SIZE + n * CORPUS_INDEX_ENTRY_SIZE;
+    prefetch_range(&corpus->corpus, (size_t)get_u64(entry), get_u32(entry + 8));
+}
+
+void open_corpus_cursor(CorpusCursor *cursor, const ReplayCorpus *corpus) {
+    memset(cursor, 0, sizeof(*cursor));
+    cursor->corpus = corpus;
+}
+
+void close_corpus_cursor(CorpusCursor *cursor) {
+    if (cursor->game.cells) destroy_game(&cursor->game);
+}
+
+// Starts the next replay that can be played under these rules, with the one
+// after it prefetched; returns -1 once the corpus is exhausted
+int corpus_next_game(CorpusCursor *cursor) {
+    const ReplayCorpus *corpus = cursor->corpus;
+    while (cursor->next < corpus->count) {
+        uint64_t n = cursor->next++;
+        prefetch_corpus_replay(corpus, n + 1);
+        ReplayReader *reader = &cursor->reader;
+        if (corpus_replay(corpus, n, reader) < 0 || reader->header.rulesVersion != RULES_VERSION) {
+            continue;
+        }
+        GameState *game = &cursor->game;
+        if (game->width != reader->header.width || game->height != reader->header.height || !game->cells) {
+            if (game->cells) destroy_game(game);
+            if (create_game(game, reader->header.width, reader->header.height, 1) < 0) {
+                return -1;
+            }
+        }
+        game->rules = reader->header.rules;
+        game->rng = reader->header.seed;
+        initialize_game(game);
+        cursor->tick = 0;
+        return 0;
+    }
+    return -1;
+}
+
+// Plays one recorded tick and returns the heading taken, leaving the state
+// after it in cursor->game; -1 at the end of the game
+int corpus_step(CorpusCursor *cursor) {
+    if (cursor->tick >= cursor->reader.header.ticks || cursor->game.isGameOver) {
+        return -1;
+    }
+    int direction = replay_action(cursor->reader.actions, cursor->tick++);
+    steer_snake(&cursor->game.snake, direction_movement(direction));
+    step_game(&cursor->game);
+    return direction;
+}
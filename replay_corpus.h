@@ -0,0 +1,57 @@
+#ifndef REPLAY_CORPUS_H
+#define REPLAY_CORPUS_H
+
+#include <stddef.h>
+#include "snake_engine.h"
+#include "replay.h"
+
+// Many replays concatenated into one file, with a separate index so readers
+// can find game n without parsing anything before it. Both files are memory
+// mapped: replays are read in place and the next one is prefetched while the
+// current one is being played.
+//
+// Index file, little-endian: "SNCI" | u32 version | u64 replay count
+//   then per replay: u64 offset into the corpus | u32 size | u32 ticks
+
+#define CORPUS_INDEX_VERSION 1
+#define CORPUS_INDEX_HEADER_SIZE 16
+#define CORPUS_INDEX_ENTRY_SIZE 16
+
+typedef struct {
+    const unsigned char *data;
+    size_t size;
+    void *file, *mapping;   // platform handles
+} MappedFile;
+
+int map_file(MappedFile *mapped, const char *path);
+void unmap_file(MappedFile *mapped);
+
+typedef struct {
+    MappedFile corpus, index;
+    uint64_t count;
+    uint64_t ticks;         // summed over every replay
+} ReplayCorpus;
+
+// Plays a corpus back game by game, one tick at a time
+typedef struct {
+    const ReplayCorpus *corpus;
+    uint64_t next;          // replay the next call to corpus_next_game() opens
+    ReplayReader reader;
+    GameState game;         // recreated only when the board size changes
+    uint32_t tick;
+} CorpusCursor;
+
+void put_corpus_entry(unsigned char *entry, uint64_t offset, uint32_t size, uint32_t ticks);
+int write_corpus_index(const char *indexPath, const unsigned char *entries, uint64_t count);
+int build_replay_corpus(const char *corpusPath, const char *indexPath, char *const *paths, long count, long *skipped);
+int open_replay_corpus(ReplayCorpus *corpus, const char *corpusPath, const char *indexPath);
+void close_replay_corpus(ReplayCorpus *corpus);
+int corpus_replay(const ReplayCorpus *corpus, uint64_t n, ReplayReader *reader);
+void prefetch_corpus_replay(const ReplayCorpus *corpus, uint64_t n);
+
+void open_corpus_cursor(CorpusCursor *cursor, const ReplayCorpus *corpus);
+void close_corpus_cursor(CorpusCursor *cursor);
+int corpus_next_game(CorpusCursor *cursor);
+int corpus_step(CorpusCursor *cursor);
+
+#endif
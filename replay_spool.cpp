@@ -0,0 +1,241 @@
+#include "replay_spool.h"
+#include "replay_corpus.h"
+#include "byte_order.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define SPOOL_MESSAGE_HEADER 4  // u32 replay size ahead of every replay in the ring
+
+int find_spool_policy(const char *name, int *policy) {
+    static const char *names[] = {"drop", "block", "spill"};
+    for (int i = 0; i < 3; i++) {
+        if (strcmp(name, names[i]) == 0) {
+            *policy = i;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+// Copies size bytes in or out of the ring at position, which may wrap
+static void ring_write(ReplaySpool *spool, uint32_t position, const unsigned char *data, uint32_t size) {
+    uint32_t start = position & (spool->capacity - 1);
+    uint32_t first = size < spool->capacity - start ? size : spool->capacity - start;
+    memcpy(spool->ring + start, data, first);
+    memcpy(spool->ring, data + first, size - first);
+}
+
+static void ring_read(const ReplaySpool *spool, uint32_t position, unsigned char *data, uint32_t size) {
+    uint32_t start = position & (spool->capacity - 1);
+    uint32_t first = size < spool->capacity - start ? size : spool->capacity - start;
+    memcpy(data, spool->ring + start, first);
+    memcpy(data + first, spool->ring, size - first);
+}
+
+static int finish_segment(ReplaySpool *spool) {
+    if (!spool->segment) {
+        return 0;
+    }
+    char path[512];
+    snprintf(path, sizeof(path), "%s-%d.snc.idx", spool->prefix, spool->segmentNumber);
+    int ok = fclose(spool->segment) == 0;
+    ok = write_corpus_index(path, spool->index, spool->indexCount) == 0 && ok;
+    spool->segment = NULL;
+    spool->segmentNumber++;
+    spool->segmentOffset = 0;
+    spool->indexCount = 0;
+    return ok ? 0 : -1;
+}
+
+// Appends one replay, given in up to two pieces, to the current segment
+static int write_replay(ReplaySpool *spool, const unsigned char *first, uint32_t firstSize, const unsigned char *second, uint32_t secondSize) {
+    if (!spool->segment) {
+        char path[512];
+        snprintf(path, sizeof(path), "%s-%d.snc", spool->prefix, spool->segmentNumber);
+        spool->segment = fopen(path, "wb");
+        if (!spool->segment) {
+            return -1;
+        }
+    }
+    if (spool->indexCount == spool->indexCapacity) {
+        size_t capacity = spool->indexCapacity ? spool->indexCapacity * 2 : 1024;
+        unsigned char *index = (unsigned char *)realloc(spool->index, capacity * CORPUS_INDEX_ENTRY_SIZE);
+        if (!index) {
+            return -1;
+        }
+        spool->index = index;
+        spool->indexCapacity = capacity;
+    }
+    unsigned char header[REPLAY_V1_HEADER_SIZE];//the tick count is all the index needs
+    uint32_t size = firstSize + secondSize;
+    uint32_t fromFirst = firstSize < sizeof(header) ? firstSize : (uint32_t)sizeof(header);
+    memcpy(header, first, fromFirst);
+    if (fromFirst < sizeof(header)) memcpy(header + fromFirst, second, sizeof(header) - fromFirst);
+    put_corpus_entry(spool->index + spool->indexCount++ * CORPUS_INDEX_ENTRY_SIZE, spool->segmentOffset, size, get_u32(header + 36));
+    int ok = fwrite(first, 1, firstSize, spool->segment) == firstSize
+          && (secondSize == 0 || fwrite(second, 1, secondSize, spool->segment) == secondSize);
+    spool->segmentOffset += size;
+    if (spool->segmentOffset >= spool->segmentBytes) {
+        ok = finish_segment(spool) == 0 && ok;
+    }
+    return ok ? 0 : -1;
+}
+
+// Drains the ring, then anything spilled while it was full; spilled replays
+// are always newer than those in the ring
+static int writer_main(void *data) {
+    ReplaySpool *spool = (ReplaySpool *)data;
+    for (;;) {
+        uint32_t tail = (uint32_t)SDL_AtomicGet(&spool->tail);
+        uint32_t head = (uint32_t)SDL_AtomicGet(&spool->head);
+        if (head != tail) {
+            unsigned char sizeBytes[SPOOL_MESSAGE_HEADER];
+            ring_read(spool, tail, sizeBytes, SPOOL_MESSAGE_HEADER);
+            uint32_t size = get_u32(sizeBytes);
+            uint32_t start = (tail + SPOOL_MESSAGE_HEADER) & (spool->capacity - 1);
+            uint32_t first = size < spool->capacity - start ? size : spool->capacity - start;
+            if (write_replay(spool, spool->ring + start, first, spool->ring, size - first) < 0) {
+                SDL_AtomicAdd(&spool->failed, 1);
+            }
+            SDL_AtomicAdd(&spool->written, 1);
+            SDL_AtomicSet(&spool->tail, (int)(tail + SPOOL_MESSAGE_HEADER + size));
+            if (SDL_AtomicCAS(&spool->producerWaiting, 1, 0)) {
+                SDL_SemPost(spool->spaceFreed);
+            }
+            continue;
+        }
+        SDL_LockMutex(spool->spillLock);
+        if ((uint32_t)SDL_AtomicGet(&spool->head) != tail) {//queued before anything spilled since, so it goes first
+            SDL_UnlockMutex(spool->spillLock);
+            continue;
+        }
+        SpillNode *node = spool->spillHead;
+        spool->spillHead = spool->spillTail = NULL;
+        SDL_AtomicSet(&spool->spilling, 0);
+        SDL_UnlockMutex(spool->spillLock);
+        if (node) {
+            while (node) {
+                SpillNode *next = node->next;
+                if (write_replay(spool, (const unsigned char *)(node + 1), (uint32_t)node->size, NULL, 0) < 0) {
+                    SDL_AtomicAdd(&spool->failed, 1);
+                }
+                SDL_AtomicAdd(&spool->written, 1);
+                free(node);
+                node = next;
+            }
+            continue;
+        }
+        if (SDL_AtomicGet(&spool->stop)) {
+            break;
+        }
+        SDL_SemWaitTimeout(spool->dataReady, 100);
+    }
+    return finish_segment(spool);
+}
+
+// bufferBytes is rounded up to a power of two
+int open_replay_spool(ReplaySpool *spool, const char *prefix, uint32_t bufferBytes, size_t segmentBytes, int policy) {
+    memset(spool, 0, sizeof(*spool));
+    spool->capacity = 4096;
+    while (spool->capacity < bufferBytes && spool->capacity < 0x40000000u) spool->capacity *= 2;
+    spool->policy = policy;
+    spool->segmentBytes = segmentBytes;
+    snprintf(spool->prefix, sizeof(spool->prefix), "%s", prefix);
+    spool->ring = (unsigned char *)malloc(spool->capacity);
+    spool->dataReady = SDL_CreateSemaphore(0);
+    spool->spaceFreed = SDL_CreateSemaphore(0);
+    spool->spillLock = SDL_CreateMutex();
+    if (!spool->ring || !spool->dataReady || !spool->spaceFreed || !spool->spillLock) {
+        close_replay_spool(spool);
+        return -1;
+    }
+    spool->thread = SDL_CreateThread(writer_main, "replay spool", spool);
+    if (!spool->thread) {
+        close_replay_spool(spool);
+        return -1;
+    }
+    return 0;
+}
+
+// Game thread side. Returns 0 once queued, 1 when dropped by the policy and
+// -1 when the replay could not be encoded for lack of memory; hash gets the
+// replay's hash, 0 unless queued
+int spool_replay(ReplaySpool *spool, const ReplayWriter *recorder, uint64_t *hash) {
+    size_t size = encoded_replay_size(recorder);
+    *hash = 0;
+    if (size + SPOOL_MESSAGE_HEADER > spool->scratchCapacity) {
+        size_t capacity = spool->scratchCapacity ? spool->scratchCapacity : 4096;
+        while (capacity < size + SPOOL_MESSAGE_HEADER) capacity *= 2;
+        unsigned char *scratch = (unsigned char *)realloc(spool->scratch, capacity);
+        if (!scratch) {
+            return -1;
+        }
+        spool->scratch = scratch;
+        spool->scratchCapacity = capacity;
+    }
+    put_u32(spool->scratch, (uint32_t)size);
+    encode_replay(recorder, spool->scratch + SPOOL_MESSAGE_HEADER);
+    uint64_t replayHash = replay_hash(spool->scratch + SPOOL_MESSAGE_HEADER, size);
+    uint32_t needed = (uint32_t)size + SPOOL_MESSAGE_HEADER;
+    while (!SDL_AtomicGet(&spool->spilling) && needed <= spool->capacity) {
+        uint32_t head = (uint32_t)SDL_AtomicGet(&spool->head);
+        uint32_t tail = (uint32_t)SDL_AtomicGet(&spool->tail);
+        if (spool->capacity - (head - tail) >= needed) {
+            ring_write(spool, head, spool->scratch, needed);
+            SDL_AtomicSet(&spool->head, (int)(head + needed));//publishes the bytes to the writer
+            SDL_AtomicAdd(&spool->queued, 1);
+            SDL_SemPost(spool->dataReady);
+            *hash = replayHash;
+            return 0;
+        }
+        if (spool->policy != SPOOL_BLOCK) break;
+        // The timeout covers a wakeup posted between the check and the wait
+        SDL_AtomicSet(&spool->producerWaiting, 1);
+        SDL_SemWaitTimeout(spool->spaceFreed, 10);
+    }
+    if (spool->policy == SPOOL_SPILL) {
+        SpillNode *node = (SpillNode *)malloc(sizeof(SpillNode) + size);
+        if (!node) {
+            return -1;
+        }
+        node->next = NULL;
+        node->size = size;
+        memcpy(node + 1, spool->scratch + SPOOL_MESSAGE_HEADER, size);
+        SDL_LockMutex(spool->spillLock);
+        if (spool->spillTail) {
+            spool->spillTail->next = node;
+        } else {
+            spool->spillHead = node;
+        }
+        spool->spillTail = node;
+        SDL_AtomicSet(&spool->spilling, 1);
+        SDL_UnlockMutex(spool->spillLock);
+        SDL_AtomicAdd(&spool->spilled, 1);
+        SDL_SemPost(spool->dataReady);
+        *hash = replayHash;
+        return 0;
+    }
+    SDL_AtomicAdd(&spool->dropped, 1);//also replays larger than the whole ring under drop or block
+    return 1;
+}
+
+// Writes out everything queued, then finishes the last segment
+void close_replay_spool(ReplaySpool *spool) {
+    if (spool->thread) {
+        SDL_AtomicSet(&spool->stop, 1);
+        SDL_SemPost(spool->dataReady);
+        int result;
+        SDL_WaitThread(spool->thread, &result);
+        if (result < 0) SDL_AtomicAdd(&spool->failed, 1);
+        spool->thread = NULL;
+    }
+    if (spool->dataReady) SDL_DestroySemaphore(spool->dataReady);
+    if (spool->spaceFreed) SDL_DestroySemaphore(spool->spaceFreed);
+    if (spool->spillLock) SDL_DestroyMutex(spool->spillLock);
+    free(spool->ring);
+    free(spool->scratch);
+    free(spool->index);
+    spool->dataReady = spool->spaceFreed = NULL;
+    spool->spillLock = NULL;
+    spool->ring = spool->scratch = spool->index = NULL;
+}
@@ -0,0 +1,58 @@
+#ifndef REPLAY_SPOOL_H
+#define REPLAY_SPOOL_H
+
+#include <SDL2/SDL.h>
+#include <stdio.h>
+#include "replay.h"
+
+// Takes replay file I/O off the game thread. A finished recording is encoded
+// into a single-producer single-consumer ring and a background thread writes
+// it to rotating corpus segments <prefix>-<n>.snc, each with its .idx (see
+// replay_corpus.h). When the disk falls behind and the ring is full the
+// policy decides: drop the replay, block the game thread until there is
+// room, or spill it to an unbounded heap queue the writer drains afterwards.
+
+enum {
+    SPOOL_DROP,
+    SPOOL_BLOCK,
+    SPOOL_SPILL
+};
+
+typedef struct SpillNode {
+    struct SpillNode *next;
+    size_t size;            // bytes right after the node
+} SpillNode;
+
+typedef struct {
+    unsigned char *ring;
+    uint32_t capacity;          // power of two
+    SDL_atomic_t head, tail;    // bytes ever queued and written, modulo 2^32
+    int policy;
+    SDL_sem *dataReady, *spaceFreed;
+    SDL_atomic_t producerWaiting;
+    SDL_mutex *spillLock;
+    SpillNode *spillHead, *spillTail;
+    SDL_atomic_t spilling;      // set while the spill queue is not empty, later replays queue behind it
+    SDL_atomic_t stop;
+    SDL_Thread *thread;
+    unsigned char *scratch;     // game thread encoding buffer
+    size_t scratchCapacity;
+
+    // Writer thread only
+    char prefix[480];
+    size_t segmentBytes;        // rotate once a segment reaches this size
+    int segmentNumber;
+    FILE *segment;
+    uint64_t segmentOffset;
+    unsigned char *index;
+    size_t indexCount, indexCapacity;
+
+    SDL_atomic_t queued, written, dropped, spilled, failed;
+} ReplaySpool;
+
+int open_replay_spool(ReplaySpool *spool, const char *prefix, uint32_t bufferBytes, size_t segmentBytes, int policy);
+int spool_replay(ReplaySpool *spool, const ReplayWriter *recorder, uint64_t *hash);
+void close_replay_spool(ReplaySpool *spool);
+int find_spool_policy(const char *name, int *policy);
+
+#endif
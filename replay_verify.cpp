@@ -0,0 +1,206 @@
+#include <SDL2/SDL.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "snake_engine.h"
+#include "replay.h"
+#include "replay_codec.h"
+
+// Leaderboard anti-cheat: re-simulates submitted replays headlessly on every
+// core and checks each claimed score, length and end against the engine.
+// Directories are scanned for .snr and compressed .snz files, one level deep.
+// Usage: replay_verify [--threads T] [--failures-only] [--rules R] [--board WxH]
+//                      <file or directory>...
+// The rules and board are the submitter's claim as much as the score is:
+// replays under anything but a named rules variant always fail, and --rules
+// and --board pin the ones the leaderboard accepts. Without --board a board
+// is only bounded by MAX_BOARD_CELLS.
+// Writes one CSV row per replay, exits 1 when any replay fails.
+
+#define MAX_THREADS 256
+
+enum {
+    VERDICT_UNREADABLE = REPLAY_WRONG_RESULT + 1    // missing, truncated or not a replay
+};
+
+static const char *verdictNames[] = {"valid", "wrong_rules", "bad_heading", "ended_early", "wrong_result", "unreadable"};
+
+typedef struct {
+    const char *path;           // owned by the path list
+    int verdict;
+    uint32_t ticks;
+    int score, length;          // as simulated
+    int claimedScore, claimedLength;
+    double seconds;
+} Job;
+
+typedef struct {
+    Job *jobs;
+    long jobCount;
+    SDL_atomic_t nextJob;
+    const char *rulesName;      // NULL for any named variant
+    int width, height;          // 0 for any board
+} Verifier;
+
+typedef struct {
+    Verifier *verifier;
+    uint64_t ticks;
+    int failed;
+} Worker;
+
+static int expected_rules(const Verifier *verifier, const ReplayHeader *header) {
+    const char *name = rules_name(&header->rules);
+    return name && (!verifier->rulesName || strcmp(name, verifier->rulesName) == 0)
+        && (!verifier->width || (header->width == verifier->width && header->height == verifier->height));
+}
+
+static void verify_job(const Verifier *verifier, Job *job, GameState *game, unsigned char **data, size_t *dataCapacity) {
+    Uint64 start = SDL_GetPerformanceCounter();
+    job->verdict = VERDICT_UNREADABLE;
+    FILE *file = fopen(job->path, "rb");
+    long length = -1;
+    if (file && fseek(file, 0, SEEK_END) == 0) {
+        length = ftell(file);
+        fseek(file, 0, SEEK_SET);
+    }
+    // The read buffer is kept across replays, only growing for longer ones
+    if (length > 0 && (size_t)length > *dataCapacity) {
+        unsigned char *grown = (unsigned char *)realloc(*data, length);
+        if (grown) {
+            *data = grown;
+            *dataCapacity = (size_t)length;
+        }
+    }
+    ReplayReader reader;
+    unsigned char *expanded = NULL;
+    const unsigned char *image = *data;
+    size_t size = (size_t)length;
+    int readable = length > 0 && (size_t)length <= *dataCapacity && fread(*data, 1, length, file) == (size_t)length;
+    if (readable && is_compressed_replay(*data, size)) {
+        readable = expand_replay(*data, (size_t)length, &expanded, &size) == 0;
+        image = expanded;
+    }
+    if (readable && open_replay(&reader, image, size) == 0) {
+        const ReplayHeader *header = &reader.header;
+        job->claimedScore = header->score;
+        job->claimedLength = header->length;
+        job->verdict = REPLAY_WRONG_RULES;
+        int expected = expected_rules(verifier, header);//checked before a board is allocated for it
+        if (expected && (game->width != header->width || game->height != header->height)) {
+            destroy_game(game);
+            if (create_game(game, header->width, header->height, 1) < 0) {
+                game->width = game->height = 0;
+                game->cells = NULL;
+            }
+        }
+        if (expected && game->cells) {
+            job->verdict = verify_replay(&reader, game);
+            job->ticks = game->tick;
+            job->score = game->score;
+            job->length = game->snake.length;
+        }
+        close_replay(&reader);
+    }
+    free(expanded);
+    if (file) fclose(file);
+    job->seconds = (double)(SDL_GetPerformanceCounter() - start) / (double)SDL_GetPerformanceFrequency();
+}
+
+static int worker_main(void *data) {
+    Worker *worker = (Worker *)data;
+    Verifier *verifier = worker->verifier;
+    GameState game = {};
+    unsigned char *buffer = NULL;
+    size_t bufferCapacity = 0;
+    for (;;) {
+        long i = SDL_AtomicAdd(&verifier->nextJob, 1);//replays differ wildly in length, so one at a time
+        if (i >= verifier->jobCount) break;
+        verify_job(verifier, &verifier->jobs[i], &game, &buffer, &bufferCapacity);
+        worker->ticks += verifier->jobs[i].ticks;
+    }
+    free(buffer);
+    if (game.cells) destroy_game(&game);
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+    static Worker workers[MAX_THREADS];
+    Verifier verifier = {};
+    ReplayPathList paths = {};
+    int threads = SDL_GetCPUCount();
+    int failuresOnly = 0;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            threads = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--failures-only") == 0) {
+            failuresOnly = 1;
+        } else if (strcmp(argv[i], "--rules") == 0 && i + 1 < argc) {
+            GameRules rules;
+            verifier.rulesName = argv[++i];
+            if (find_rules(verifier.rulesName, &rules) < 0) {
+                printf("Unknown rules: %s\n", verifier.rulesName);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--board") == 0 && i + 1 < argc) {
+            if (sscanf(argv[++i], "%dx%d", &verifier.width, &verifier.height) != 2 || verifier.width < 2 || verifier.height < 1) {
+                printf("Expected --board WxH\n");
+                return 1;
+            }
+        } else if (argv[i][0] == '-') {
+            printf("Unknown option: %s\n", argv[i]);
+            return 1;
+        } else if (add_replay_path(&paths, argv[i]) < 0) {
+            printf("Out of memory\n");
+            return 1;
+        }
+    }
+    verifier.jobCount = paths.count;
+    verifier.jobs = (Job *)calloc(paths.count ? paths.count : 1, sizeof(Job));
+    if (!verifier.jobs) {
+        printf("Out of memory\n");
+        return 1;
+    }
+    for (long i = 0; i < paths.count; i++) verifier.jobs[i].path = paths.paths[i];
+    if (threads < 1) threads = 1;
+    if (threads > MAX_THREADS) threads = MAX_THREADS;
+    if (verifier.jobCount == 0) {
+        printf("Usage: %s [--threads T] [--failures-only] [--rules R] [--board WxH] <file or directory>...\n", argv[0]);
+        return 1;
+    }
+    if (threads > verifier.jobCount) threads = (int)verifier.jobCount;
+
+    SDL_AtomicSet(&verifier.nextJob, 0);
+    SDL_Thread *handles[MAX_THREADS];
+    Uint64 start = SDL_GetPerformanceCounter();
+    for (int t = 0; t < threads; t++) {
+        workers[t].verifier = &verifier;
+        handles[t] = SDL_CreateThread(worker_main, "verify", &workers[t]);
+        if (!handles[t]) {
+            printf("Thread creation failed: %s\n", SDL_GetError());
+            return 1;
+        }
+    }
+    uint64_t ticks = 0;
+    for (int t = 0; t < threads; t++) {
+        SDL_WaitThread(handles[t], NULL);
+        ticks += workers[t].ticks;
+    }
+    double seconds = (double)(SDL_GetPerformanceCounter() - start) / (double)SDL_GetPerformanceFrequency();
+
+    // Rows come out in the order the paths were given, whatever thread ran them
+    long failures = 0;
+    printf("path,verdict,ticks,score,length,claimed_score,claimed_length,microseconds\n");
+    for (long i = 0; i < verifier.jobCount; i++) {
+        const Job *job = &verifier.jobs[i];
+        failures += job->verdict != REPLAY_VALID;
+        if (!failuresOnly || job->verdict != REPLAY_VALID) {
+            printf("%s,%s,%u,%d,%d,%d,%d,%.1f\n", job->path, verdictNames[job->verdict], job->ticks, job->score, job->length,
+                   job->claimedScore, job->claimedLength, job->seconds * 1e6);
+        }
+    }
+    free(verifier.jobs);
+    free_replay_paths(&paths);
+    fprintf(stderr, "%ld replays, %ld failed, %llu ticks in %.3f s on %d threads: %.0f replays/s, %.0f ticks/s\n",
+            verifier.jobCount, failures, (unsigned long long)ticks, seconds, threads, verifier.jobCount / seconds, ticks / seconds);
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,268 @@
+#include "score_log.h"
+#include "byte_order.h"
+#include "checksum.h"
+#include <stdlib.h>
+#include <string.h>
+#ifdef _WIN32
+#include <io.h>
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+static void encode_record(const ScoreRecord *record, unsigned char *out) {
+    put_u32(out + 4, (uint32_t)record->score);
+    put_u32(out + 8, (uint32_t)record->length);
+    put_u32(out + 12, record->seed);
+    put_u64(out + 16, record->timestamp);
+    put_u64(out + 24, record->replayHash);
+    put_u32(out, crc32(out + 4, SCORE_RECORD_SIZE - 4));
+}
+
+static int decode_record(const unsigned char *in, ScoreRecord *record) {
+    if (get_u32(in) != crc32(in + 4, SCORE_RECORD_SIZE - 4)) {
+        return -1;
+    }
+    record->score = (int)get_u32(in + 4);
+    record->length = (int)get_u32(in + 8);
+    record->seed = get_u32(in + 12);
+    record->timestamp = get_u64(in + 16);
+    record->replayHash = get_u64(in + 24);
+    return 0;
+}
+
+// Flushes stdio and the OS cache for file down to the disk
+static int sync_file(FILE *file) {
+    if (fflush(file) != 0) {
+        return -1;
+    }
+#ifdef _WIN32
+    return _commit(_fileno(file));
+#else
+    return fsync(fileno(file));
+#endif
+}
+
+static int truncate_file(FILE *file, long size) {
+#ifdef _WIN32
+    return _chsize_s(_fileno(file), size) == 0 ? 0 : -1;
+#else
+    return ftruncate(fileno(file), size);
+#endif
+}
+
+// Atomically puts from in place of to, so readers see the old file or the new one
+static int replace_file(const char *from, const char *to) {
+#ifdef _WIN32
+    return MoveFileExA(from, to, MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) ? 0 : -1;
+#else
+    return rename(from, to);
+#endif
+}
+
+// Keeps the best list sorted, a later record goes after earlier ones with the same score
+static void add_best(ScoreLog *scores, const ScoreRecord *record) {
+    if (scores->bestCount == scores->keep && record->score <= scores->best[scores->keep - 1].score) {
+        return;
+    }
+    int low = 0, high = scores->bestCount;
+    while (low < high) {
+        int middle = (low + high) / 2;
+        if (scores->best[middle].score >= record->score) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    int moved = scores->bestCount - low - (scores->bestCount == scores->keep);
+    memmove(&scores->best[low + 1], &scores->best[low], sizeof(ScoreRecord) * moved);
+    scores->best[low] = *record;
+    if (scores->bestCount < scores->keep) scores->bestCount++;
+}
+
+static int start_log(ScoreLog *scores, uint64_t generation) {
+    if (scores->log) fclose(scores->log);
+    scores->log = fopen(scores->logPath, "w+b");
+    if (!scores->log) {
+        return -1;
+    }
+    unsigned char header[SCORE_LOG_HEADER_SIZE];
+    memcpy(header, "SNSL", 4);
+    put_u32(header + 4, SCORE_LOG_VERSION);
+    put_u64(header + 8, generation);
+    scores->generation = generation;
+    scores->logRecords = 0;
+    if (fwrite(header, 1, sizeof(header), scores->log) != sizeof(header)) {
+        return -1;
+    }
+    return sync_file(scores->log);
+}
+
+// Returns 0 with the generation and log offset it covers, -1 when missing or damaged
+static int load_snapshot(ScoreLog *scores, uint64_t *generation, uint64_t *logOffset) {
+    FILE *file = fopen(scores->snapshotPath, "rb");
+    if (!file) {
+        return -1;
+    }
+    unsigned char header[SCORE_SNAPSHOT_HEADER_SIZE];
+    int ok = fread(header, 1, sizeof(header), file) == sizeof(header) && memcmp(header, "SNSS", 4) == 0
+          && get_u32(header + 4) == SCORE_LOG_VERSION && get_u32(header + 36) == crc32(header, 36);
+    uint32_t count = ok ? get_u32(header + 32) : 0;
+    scores->bestCount = 0;
+    for (uint32_t i = 0; ok && i < count; i++) {
+        unsigned char bytes[SCORE_RECORD_SIZE];
+        ScoreRecord record;
+        ok = fread(bytes, 1, sizeof(bytes), file) == sizeof(bytes) && decode_record(bytes, &record) == 0;
+        if (ok) add_best(scores, &record);
+    }
+    fclose(file);
+    if (!ok) {
+        scores->bestCount = 0;
+        return -1;
+    }
+    *generation = get_u64(header + 8);
+    *logOffset = get_u64(header + 16);
+    scores->totalGames = get_u64(header + 24);
+    return 0;
+}
+
+// Reads the intact records from offset on and cuts off anything after them
+static int recover_log_tail(ScoreLog *scores, uint64_t offset) {
+    FILE *log = scores->log;
+    if (fseek(log, 0, SEEK_END) != 0 || (uint64_t)ftell(log) < offset || fseek(log, (long)offset, SEEK_SET) != 0) {
+        return -1;
+    }
+    unsigned char bytes[SCORE_RECORD_SIZE];
+    ScoreRecord record;
+    while (fread(bytes, 1, sizeof(bytes), log) == sizeof(bytes) && decode_record(bytes, &record) == 0) {
+        add_best(scores, &record);
+        scores->totalGames++;
+        offset += SCORE_RECORD_SIZE;
+    }
+    scores->logRecords = (offset - SCORE_LOG_HEADER_SIZE) / SCORE_RECORD_SIZE;
+    if (truncate_file(log, (long)offset) < 0 || fseek(log, 0, SEEK_END) != 0) {
+        return -1;
+    }
+    return 0;
+}
+
+// keep is how many of the best records are held and survive compaction;
+// batchSize is how many appends share one fsync
+int open_score_log(ScoreLog *scores, const char *basePath, int keep, int batchSize) {
+    memset(scores, 0, sizeof(*scores));
+    snprintf(scores->logPath, sizeof(scores->logPath), "%s.log", basePath);
+    snprintf(scores->snapshotPath, sizeof(scores->snapshotPath), "%s.snap", basePath);
+    scores->keep = keep > 0 ? keep : 1;
+    scores->batchSize = batchSize > 0 ? batchSize : 1;
+    scores->best = (ScoreRecord *)malloc(sizeof(ScoreRecord) * scores->keep);
+    scores->pending = (unsigned char *)malloc((size_t)SCORE_RECORD_SIZE * scores->batchSize);
+    if (!scores->best || !scores->pending) {
+        close_score_log(scores);
+        return -1;
+    }
+    uint64_t snapshotGeneration = 0, logOffset = SCORE_LOG_HEADER_SIZE;
+    int haveSnapshot = load_snapshot(scores, &snapshotGeneration, &logOffset) == 0;
+    scores->log = fopen(scores->logPath, "r+b");
+    unsigned char header[SCORE_LOG_HEADER_SIZE];
+    int recovered = -1;
+    if (scores->log && fread(header, 1, sizeof(header), scores->log) == sizeof(header) && memcmp(header, "SNSL", 4) == 0
+        && get_u32(header + 4) == SCORE_LOG_VERSION) {
+        scores->generation = get_u64(header + 8);
+        if (!haveSnapshot || scores->generation > snapshotGeneration) {
+            recovered = recover_log_tail(scores, SCORE_LOG_HEADER_SIZE);
+        } else if (scores->generation == snapshotGeneration) {
+            recovered = recover_log_tail(scores, logOffset);
+        }
+        // An older generation was already folded into the snapshot before a
+        // crash interrupted compaction, so it is started over
+    }
+    if (recovered < 0 && start_log(scores, haveSnapshot ? snapshotGeneration : 1) < 0) {
+        close_score_log(scores);
+        return -1;
+    }
+    return 0;
+}
+
+static int write_pending(ScoreLog *scores) {
+    if (scores->pendingCount == 0) {
+        return 0;
+    }
+    size_t size = (size_t)scores->pendingCount * SCORE_RECORD_SIZE;
+    scores->pendingCount = 0;
+    scores->syncs++;
+    if (fwrite(scores->pending, 1, size, scores->log) != size) {
+        return -1;
+    }
+    return sync_file(scores->log);
+}
+
+int append_score(ScoreLog *scores, const ScoreRecord *record) {
+    add_best(scores, record);
+    scores->totalGames++;
+    scores->logRecords++;
+    encode_record(record, scores->pending + (size_t)scores->pendingCount * SCORE_RECORD_SIZE);
+    if (++scores->pendingCount == scores->batchSize) {
+        return sync_score_log(scores);
+    }
+    return 0;
+}
+
+// Makes every appended record durable, compacting when the log has grown long
+int sync_score_log(ScoreLog *scores) {
+    if (write_pending(scores) < 0) {
+        return -1;
+    }
+    if (scores->logRecords >= SCORE_COMPACT_RECORDS) {
+        return compact_score_log(scores);
+    }
+    return 0;
+}
+
+// The snapshot of the next generation replaces the old one before the log is
+// restarted, so a crash in between leaves a snapshot that already holds
+// everything in the log
+int compact_score_log(ScoreLog *scores) {
+    if (write_pending(scores) < 0) {
+        return -1;
+    }
+    char tempPath[520];
+    snprintf(tempPath, sizeof(tempPath), "%s.tmp", scores->snapshotPath);
+    FILE *file = fopen(tempPath, "wb");
+    if (!file) {
+        return -1;
+    }
+    unsigned char header[SCORE_SNAPSHOT_HEADER_SIZE];
+    memcpy(header, "SNSS", 4);
+    put_u32(header + 4, SCORE_LOG_VERSION);
+    put_u64(header + 8, scores->generation + 1);
+    put_u64(header + 16, SCORE_LOG_HEADER_SIZE);
+    put_u64(header + 24, scores->totalGames);
+    put_u32(header + 32, (uint32_t)scores->bestCount);
+    put_u32(header + 36, crc32(header, 36));
+    int ok = fwrite(header, 1, sizeof(header), file) == sizeof(header);
+    for (int i = 0; ok && i < scores->bestCount; i++) {
+        unsigned char bytes[SCORE_RECORD_SIZE];
+        encode_record(&scores->best[i], bytes);
+        ok = fwrite(bytes, 1, sizeof(bytes), file) == sizeof(bytes);
+    }
+    ok = ok && sync_file(file) == 0;
+    ok = fclose(file) == 0 && ok;
+    if (!ok || replace_file(tempPath, scores->snapshotPath) < 0) {
+        remove(tempPath);
+        return -1;
+    }
+    scores->compactions++;
+    return start_log(scores, scores->generation + 1);
+}
+
+void close_score_log(ScoreLog *scores) {
+    if (scores->log) {
+        write_pending(scores);
+        fclose(scores->log);
+    }
+    free(scores->best);
+    free(scores->pending);
+    scores->log = NULL;
+    scores->best = NULL;
+    scores->pending = NULL;
+}
@@ -0,0 +1,54 @@
+#ifndef SCORE_LOG_H
+#define SCORE_LOG_H
+
+#include <stdio.h>
+#include "snake_engine.h"
+
+// Persistent leaderboard. Every finished game is appended to <base>.log;
+// appends are buffered and written with one fsync per batch, so a crash
+// loses at most the unsynced batch. Once the log grows long enough the
+// leaderboard is compacted into <base>.snap and a fresh log is started.
+// Startup loads the snapshot and replays only the log written since.
+//
+// Files, little-endian:
+//   log:      "SNSL" | u32 version | u64 generation | records...
+//   snapshot: "SNSS" | u32 version | u64 generation | u64 log offset |
+//             u64 total games | u32 record count | u32 crc of the above | records...
+//   record:   u32 crc of the rest | i32 score | i32 length | u32 seed |
+//             u64 timestamp | u64 replay hash
+// The snapshot covers the log of its generation up to the log offset. A torn
+// record at the end of the log fails its crc and is cut off on recovery.
+
+#define SCORE_LOG_VERSION 1
+#define SCORE_LOG_HEADER_SIZE 16
+#define SCORE_SNAPSHOT_HEADER_SIZE 40
+#define SCORE_RECORD_SIZE 32
+#define SCORE_COMPACT_RECORDS 65536 // log length that triggers compaction
+
+typedef struct {
+    int score, length;
+    uint32_t seed;
+    uint64_t timestamp;     // seconds since the epoch
+    uint64_t replayHash;    // replay_hash() of the saved replay, 0 without one
+} ScoreRecord;
+
+typedef struct {
+    char logPath[512], snapshotPath[512];
+    FILE *log;
+    uint64_t generation;
+    uint64_t logRecords;        // in the current log, synced or not
+    uint64_t totalGames;
+    ScoreRecord *best;          // highest score first
+    int bestCount, keep;
+    unsigned char *pending;     // encoded records not yet written
+    int pendingCount, batchSize;
+    long syncs, compactions;
+} ScoreLog;
+
+int open_score_log(ScoreLog *scores, const char *basePath, int keep, int batchSize);
+int append_score(ScoreLog *scores, const ScoreRecord *record);
+int sync_score_log(ScoreLog *scores);
+int compact_score_log(ScoreLog *scores);
+void close_score_log(ScoreLog *scores);
+
+#endif
@@ -0,0 +1,84 @@
+#ifndef SNAKE_AGENT_API_H
+#define SNAKE_AGENT_API_H
+
+/*
+ * Stable C ABI for controller plugins loaded at runtime with
+ * --autopilot plugin:<path to .dll/.so>. A plugin exports the four
+ * functions below. Every tick the game calls snake_agent_act() with a
+ * view straight into its own state: nothing is copied or allocated, and
+ * the pointers are only valid for the duration of the call.
+ *
+ * Fields are only ever appended; a plugin built against an older version
+ * keeps working as long as it reports that version.
+ */
+
+#include <stdint.h>
+
+#define SNAKE_AGENT_API_VERSION 2
+
+#define SNAKE_AGENT_UP 0
+#define SNAKE_AGENT_DOWN 1
+#define SNAKE_AGENT_LEFT 2
+#define SNAKE_AGENT_RIGHT 3
+
+#if defined(_WIN32)
+#define SNAKE_AGENT_EXPORT __declspec(dllexport)
+#else
+#define SNAKE_AGENT_EXPORT __attribute__((visibility("default")))
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct {
+    int32_t x, y;
+} SnakeAgentPosition;
+
+typedef struct {
+    uint32_t apiVersion;
+    int32_t width, height;          // board size in cells
+    const SnakeAgentPosition *body; // ring buffer, segment i is body[(bodyHead + i) % bodyCapacity]
+    int32_t bodyCapacity;
+    int32_t bodyHead;
+    int32_t length;
+    SnakeAgentPosition movement;    // current heading, reversing it is ignored
+    const uint8_t *cells;           // width * height, nonzero where the snake is
+    SnakeAgentPosition food;
+    int32_t foodActive;
+    SnakeAgentPosition bonus;
+    int32_t bonusActive;
+    int32_t score;
+    uint32_t tick;
+    // version 2
+    SnakeAgentPosition poison;      // eating it costs points, see GameRules
+    int32_t poisonActive;
+} SnakeAgentView;
+
+typedef int32_t (*SnakeAgentApiVersionFunction)(void);
+typedef void *(*SnakeAgentCreateFunction)(int32_t width, int32_t height);
+typedef int32_t (*SnakeAgentActFunction)(void *agent, const SnakeAgentView *view);
+typedef void (*SnakeAgentDestroyFunction)(void *agent);
+
+SNAKE_AGENT_EXPORT int32_t snake_agent_api_version(void);
+SNAKE_AGENT_EXPORT void *snake_agent_create(int32_t width, int32_t height);
+SNAKE_AGENT_EXPORT int32_t snake_agent_act(void *agent, const SnakeAgentView *view);
+SNAKE_AGENT_EXPORT void snake_agent_destroy(void *agent);
+
+/*
+ * Optional: policies that drive many games at once can also export
+ * snake_agent_act_batch(). It receives count observations back to back,
+ * each observationSize floats made of six width * height row-major planes
+ * (body, head, food, bonus, 1.0 where present, then 1 / (1 + steps to the
+ * food) for cells that can reach it, then poison, 1.0 where present), and
+ * writes one direction per observation into actions.
+ */
+typedef void (*SnakeAgentActBatchFunction)(void *agent, const float *observations, int32_t count, int32_t observationSize, int32_t *actions);
+
+SNAKE_AGENT_EXPORT void snake_agent_act_batch(void *agent, const float *observations, int32_t count, int32_t observationSize, int32_t *actions);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
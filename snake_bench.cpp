@@ -0,0 +1,650 @@
+#include <SDL2/SDL.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "snake_engine.h"
+#include "hamilton_agent.h"
+#include "mcts_agent.h"
+#include "batch_runner.h"
+#include "observation.h"
+#include "plugin_agent.h"
+#include "reachability.h"
+#include "replay.h"
+#include "replay_codec.h"
+#include "agent.h"
+#include "byte_order.h"
+#include "game_save.h"
+#include "replay_spool.h"
+
+// Headless benchmarks. Usage: snake_bench <benchmark> [args...]
+
+static double seconds_since(Uint64 start) {
+    return (double)(SDL_GetPerformanceCounter() - start) / (double)SDL_GetPerformanceFrequency();
+}
+
+// Plays one full game per square board size with the Hamiltonian agent
+static int bench_hamilton(int argc, char *argv[]) {
+    static const int defaultSizes[] = {10, 20, 50, 100, 200};
+    int sizeCount = argc > 0 ? argc : (int)(sizeof(defaultSizes) / sizeof(defaultSizes[0]));
+    printf("%-9s %10s %12s %10s %14s\n", "board", "length", "ticks", "seconds", "decisions/s");
+    for (int i = 0; i < sizeCount; i++) {
+        int size = argc > 0 ? atoi(argv[i]) : defaultSizes[i];
+        GameState game;
+        HamiltonAgent agent;
+        if (create_game(&game, size, size, 1) < 0 || create_hamilton_agent(&agent, size, size) < 0) {
+            printf("%dx%d: no Hamiltonian cycle\n", size, size);
+            destroy_game(&game);
+            continue;
+        }
+        initialize_game(&game);
+        Uint64 start = SDL_GetPerformanceCounter();
+        while (!game.isGameOver) {
+            steer_snake(&game.snake, direction_movement(hamilton_agent_decide(&agent, &game)));
+            step_game(&game);
+        }
+        double elapsed = seconds_since(start);
+        char board[16];
+        snprintf(board, sizeof(board), "%dx%d", size, size);
+        printf("%-9s %5d/%-5d %12u %10.3f %14.0f\n", board, game.snake.length, size * size, game.tick, elapsed, game.tick / elapsed);
+        destroy_hamilton_agent(&agent);
+        destroy_game(&game);
+    }
+    return 0;
+}
+
+// Playouts per second of one MCTS decision budget as the thread count grows
+static int bench_mcts(int argc, char *argv[]) {
+    static const int defaultThreads[] = {1, 2, 4, 8, 16, 32, 64};
+    int runCount = argc > 0 ? argc : (int)(sizeof(defaultThreads) / sizeof(defaultThreads[0]));
+    GameState game;
+    if (create_game(&game, 35, 30, 1) < 0) {
+        return 1;
+    }
+    initialize_game(&game);
+    printf("%d cores\n%8s %14s %9s\n", SDL_GetCPUCount(), "threads", "playouts/s", "speedup");
+    double single = 0;
+    for (int i = 0; i < runCount; i++) {
+        MctsConfig config = default_mcts_config();
+        config.threads = argc > 0 ? atoi(argv[i]) : defaultThreads[i];
+        config.timeLimitMs = 250;
+        MctsAgent agent;
+        if (create_mcts_agent(&agent, game.width, game.height, &config) < 0) {
+            printf("%8d could not start\n", config.threads);
+            continue;
+        }
+        long playouts = 0;
+        Uint64 start = SDL_GetPerformanceCounter();
+        for (int decision = 0; decision < 4; decision++) {
+            mcts_agent_decide(&agent, &game);
+            playouts += agent.lastIterations;
+        }
+        double rate = playouts / seconds_since(start);
+        if (i == 0) single = rate / config.threads;
+        printf("%8d %14.0f %8.2fx\n", config.threads, rate, rate / single);
+        destroy_mcts_agent(&agent);
+    }
+    destroy_game(&game);
+    return 0;
+}
+
+// Stand-in for a learned policy: reads the head and food planes of each observation
+static void greedy_batch_policy(void *user, const float *observations, int count, int observationSize, int *actions) {
+    const int *size = (const int *)user;
+    int planeSize = size[0] * size[1];
+    for (int i = 0; i < count; i++) {
+        const float *observation = observations + (size_t)i * observationSize;
+        int head = 0, food = 0;
+        for (int cell = 0; cell < planeSize; cell++) {
+            if (observation[OBSERVATION_HEAD * planeSize + cell] > 0) head = cell;
+            if (observation[OBSERVATION_FOOD * planeSize + cell] > 0) food = cell;
+        }
+        int dx = food % size[0] - head % size[0], dy = food / size[0] - head / size[0];
+        actions[i] = dx ? (dx < 0 ? DIRECTION_LEFT : DIRECTION_RIGHT) : (dy < 0 ? DIRECTION_UP : DIRECTION_DOWN);
+    }
+}
+
+typedef struct {
+    BatchPolicyFunction policy;
+    void *user;
+} PerGamePolicy;
+
+// The unbatched baseline: the same policy, called once per game
+static void per_game_policy(void *user, const float *observations, int count, int observationSize, int *actions) {
+    PerGamePolicy *inner = (PerGamePolicy *)user;
+    for (int i = 0; i < count; i++) {
+        inner->policy(inner->user, observations + (size_t)i * observationSize, 1, observationSize, actions + i);
+    }
+}
+
+// Steps per second of many games driven per game, batched, and batched with pipelining
+static int bench_batch(int argc, char *argv[]) {
+    int envCount = argc > 0 ? atoi(argv[0]) : 256;
+    int boardSize[2] = {35, 30};
+    BatchPolicyFunction policy = greedy_batch_policy;
+    void *user = boardSize;
+    PluginAgent plugin;
+    int usePlugin = argc > 1;
+    if (usePlugin) {
+        if (load_plugin_agent(&plugin, argv[1], boardSize[0], boardSize[1]) < 0 || !plugin.actBatch) {
+            printf("%s has no snake_agent_act_batch\n", argv[1]);
+            return 1;
+        }
+        policy = plugin_agent_decide_batch;
+        user = &plugin;
+    }
+    PerGamePolicy perGame = {policy, user};
+    const char *modes[3] = {"per game", "batched", "pipelined"};
+    printf("%d games on %dx%d\n%-10s %14s\n", envCount, boardSize[0], boardSize[1], "mode", "steps/s");
+    for (int mode = 0; mode < 3; mode++) {
+        BatchRunner runner;
+        if (create_batch_runner(&runner, envCount, boardSize[0], boardSize[1], 1, mode == 0 ? per_game_policy : policy, mode == 0 ? (void *)&perGame : user, mode == 2) < 0) {
+            return 1;
+        }
+        Uint64 start = SDL_GetPerformanceCounter();
+        run_batch_ticks(&runner, 200);
+        printf("%-10s %14.0f\n", modes[mode], runner.steps / seconds_since(start));
+        destroy_batch_runner(&runner);
+    }
+    if (usePlugin) unload_plugin_agent(&plugin);
+    return 0;
+}
+
+// Per-tick cost of answering all four candidate moves incrementally versus by
+// fresh flood fills, as the Hamiltonian agent grows the snake to 90% of the board
+static int bench_reach(int argc, char *argv[]) {
+    int size = argc > 0 ? atoi(argv[0]) : 40;
+    GameState game;
+    HamiltonAgent agent;
+    ReachabilityTracker tracker;
+    if (create_game(&game, size, size, 1) < 0 || create_hamilton_agent(&agent, size, size) < 0 || create_reachability(&tracker, size, size) < 0) {
+        return 1;
+    }
+    initialize_game(&game);
+    rebuild_reachability(&tracker, &game);
+    printf("%dx%d board\n%7s %16s %16s %9s %9s\n", size, size, "length", "tracker us/tick", "flood us/tick", "speedup", "rebuilds");
+    for (int percent = 10; percent <= 90 && !game.isGameOver; percent += 10) {
+        while (!game.isGameOver && game.snake.length * 100 < percent * size * size) {
+            steer_snake(&game.snake, direction_movement(hamilton_agent_decide(&agent, &game)));
+            step_game(&game);
+        }
+        Uint64 trackerTicks = 0, floodTicks = 0;
+        long rebuilds = tracker.rebuilds, checksum = 0;
+        int samples = 0;
+        for (; samples < 2000 && !game.isGameOver; samples++) {
+            Uint64 start = SDL_GetPerformanceCounter();
+            sync_reachability(&tracker, &game);
+            for (int d = 0; d < 4; d++) checksum += reachable_after_move(&tracker, &game, d);
+            Uint64 middle = SDL_GetPerformanceCounter();
+            for (int d = 0; d < 4; d++) checksum -= flood_fill_after_move(&tracker, &game, d);
+            Uint64 end = SDL_GetPerformanceCounter();
+            trackerTicks += middle - start;
+            floodTicks += end - middle;
+            steer_snake(&game.snake, direction_movement(hamilton_agent_decide(&agent, &game)));
+            step_game(&game);
+        }
+        if (samples == 0) break;
+        double frequency = (double)SDL_GetPerformanceFrequency() / 1e6;
+        double trackerUs = trackerTicks / frequency / samples, floodUs = floodTicks / frequency / samples;
+        printf("%6d%% %16.2f %16.2f %8.1fx %9ld%s\n", percent, trackerUs, floodUs, floodUs / trackerUs, tracker.rebuilds - rebuilds, checksum ? "  MISMATCH" : "");
+    }
+    destroy_reachability(&tracker);
+    destroy_hamilton_agent(&agent);
+    destroy_game(&game);
+    return 0;
+}
+
+// The copy copy_game() used to make: the whole ring and the whole grid
+static void copy_game_full(GameState *destination, const GameState *source) {
+    Position *body = destination->snake.body;
+    unsigned char *cells = destination->cells;
+    *destination = *source;
+    destination->snake.body = body;
+    destination->cells = cells;
+    memcpy(body, source->snake.body, sizeof(Position) * source->snake.capacity);
+    memcpy(cells, source->cells, source->width * source->height);
+}
+
+// Clones per second on the default 35x30 board as the snake grows
+static int bench_clone(int argc, char *argv[]) {
+    static const int defaultLengths[] = {2, 16, 64, 256, 1024};
+    int lengthCount = argc > 0 ? argc : (int)(sizeof(defaultLengths) / sizeof(defaultLengths[0]));
+    const int rounds = 200000;
+    GameState game, clone;
+    HamiltonAgent agent;
+    GameSnapshot snapshot = {};
+    if (create_game(&game, 35, 30, 1) < 0 || create_game(&clone, 35, 30, 1) < 0 || create_hamilton_agent(&agent, 35, 30) < 0) {
+        return 1;
+    }
+    initialize_game(&game);
+    printf("35x30 board, %d clones per run\n%7s %16s %16s %16s %16s\n", rounds, "length", "full copy/s", "copy_game/s", "snapshot/s",
+           "restore/s");
+    for (int i = 0; i < lengthCount; i++) {
+        int length = argc > 0 ? atoi(argv[i]) : defaultLengths[i];
+        while (!game.isGameOver && game.snake.length < length) {
+            steer_snake(&game.snake, direction_movement(hamilton_agent_decide(&agent, &game)));
+            step_game(&game);
+        }
+        long checksum = 0;
+        Uint64 start = SDL_GetPerformanceCounter();
+        for (int r = 0; r < rounds; r++) {
+            copy_game_full(&clone, &game);
+            checksum += clone.snake.length;
+        }
+        double full = seconds_since(start);
+        start = SDL_GetPerformanceCounter();
+        for (int r = 0; r < rounds; r++) {
+            copy_game(&clone, &game);
+            checksum += clone.snake.length;
+        }
+        double incremental = seconds_since(start);
+        start = SDL_GetPerformanceCounter();
+        for (int r = 0; r < rounds; r++) {
+            if (save_snapshot(&snapshot, &game) < 0) return 1;
+            restore_snapshot(&clone, &snapshot);
+            checksum += clone.snake.length;
+        }
+        double snapshotSeconds = seconds_since(start);
+        start = SDL_GetPerformanceCounter();
+        for (int r = 0; r < rounds; r++) {//seeks and loads restore a snapshot taken once
+            restore_snapshot(&clone, &snapshot);
+            checksum += clone.snake.length;
+        }
+        double restoreSeconds = seconds_since(start);
+        printf("%7d %16.0f %16.0f %16.0f %16.0f%s\n", game.snake.length, rounds / full, rounds / incremental, rounds / snapshotSeconds,
+               rounds / restoreSeconds, checksum == 4L * rounds * game.snake.length ? "" : "  MISMATCH");
+    }
+    free_snapshot(&snapshot);
+    destroy_hamilton_agent(&agent);
+    destroy_game(&clone);
+    destroy_game(&game);
+    return 0;
+}
+
+// Counts the move sequences of the given depth, rewinding each tick with its undo record
+static long search_undo(GameState *game, StepUndo *journal, int depth) {
+    if (depth == 0 || game->isGameOver) return 1;
+    long leaves = 0;
+    for (int d = 0; d < 4; d++) {
+        Position move = direction_movement(d);
+        if (move.x == -game->snake.movement.x && move.y == -game->snake.movement.y) continue;
+        step_game_undoable(game, move, journal);
+        leaves += search_undo(game, journal + 1, depth - 1);
+        undo_step(game, journal);
+    }
+    return leaves;
+}
+
+// The same search keeping one copy of the game per level
+static long search_clone(GameState *levels, int depth) {
+    GameState *game = &levels[0];
+    if (depth == 0 || game->isGameOver) return 1;
+    long leaves = 0;
+    for (int d = 0; d < 4; d++) {
+        Position move = direction_movement(d);
+        if (move.x == -game->snake.movement.x && move.y == -game->snake.movement.y) continue;
+        copy_game(&levels[1], game);
+        steer_snake(&levels[1].snake, move);
+        step_game(&levels[1]);
+        leaves += search_clone(levels + 1, depth - 1);
+    }
+    return leaves;
+}
+
+// Exhaustive depth-first search from positions of growing length
+static int bench_undo(int argc, char *argv[]) {
+    static const int lengths[] = {2, 64, 256, 1024};
+    int depth = argc > 0 ? atoi(argv[0]) : 12;
+    if (depth < 1 || depth > 16) depth = 12;
+    GameState game, levels[17];
+    HamiltonAgent agent;
+    StepUndo journal[16];
+    if (create_game(&game, 35, 30, 1) < 0 || create_hamilton_agent(&agent, 35, 30) < 0) {
+        return 1;
+    }
+    for (int i = 0; i <= depth; i++) {
+        if (create_game(&levels[i], 35, 30, 1) < 0) return 1;
+    }
+    initialize_game(&game);
+    printf("35x30 board, depth %d\n%7s %12s %16s %16s\n", depth, "length", "leaves", "undo leaves/s", "clone leaves/s");
+    for (int i = 0; i < (int)(sizeof(lengths) / sizeof(lengths[0])); i++) {
+        while (!game.isGameOver && game.snake.length < lengths[i]) {
+            steer_snake(&game.snake, direction_movement(hamilton_agent_decide(&agent, &game)));
+            step_game(&game);
+        }
+        Uint64 start = SDL_GetPerformanceCounter();
+        long undoLeaves = search_undo(&game, journal, depth);
+        double undoSeconds = seconds_since(start);
+        copy_game(&levels[0], &game);
+        start = SDL_GetPerformanceCounter();
+        long cloneLeaves = search_clone(levels, depth);
+        double cloneSeconds = seconds_since(start);
+        printf("%7d %12ld %16.0f %16.0f%s\n", game.snake.length, undoLeaves, undoLeaves / undoSeconds, cloneLeaves / cloneSeconds,
+               undoLeaves == cloneLeaves ? "" : "  MISMATCH");
+    }
+    for (int i = 0; i <= depth; i++) destroy_game(&levels[i]);
+    destroy_hamilton_agent(&agent);
+    destroy_game(&game);
+    return 0;
+}
+
+// Records one full-board Hamiltonian game per keyframe interval, then seeks to
+// random ticks in it
+static int bench_seek(int argc, char *argv[]) {
+    static const uint32_t defaults[] = {0, 10000, 1000, 100};
+    static const char *path = "snake_bench_seek.snr";
+    int count = argc > 0 ? argc : (int)(sizeof(defaults) / sizeof(defaults[0]));
+    GameState game;
+    HamiltonAgent agent;
+    if (create_game(&game, 35, 30, 1) < 0 || create_hamilton_agent(&agent, 35, 30) < 0) {
+        return 1;
+    }
+    printf("35x30 board\n%9s %10s %10s %12s %14s\n", "interval", "ticks", "keyframes", "file bytes", "seek us");
+    for (int i = 0; i < count; i++) {
+        uint32_t interval = argc > 0 ? (uint32_t)strtoul(argv[i], NULL, 10) : defaults[i];
+        ReplayWriter writer = {};
+        game.rng = 1;
+        begin_replay(&writer, &game, interval);
+        initialize_game(&game);
+        while (!game.isGameOver) {
+            steer_snake(&game.snake, direction_movement(hamilton_agent_decide(&agent, &game)));
+            record_replay_tick(&writer, &game);
+            step_game(&game);
+        }
+        end_replay(&writer, &game);
+        unsigned char *data = NULL;
+        size_t size = 0;
+        ReplayReader reader;
+        if (save_replay(&writer, path) < 0 || load_file(path, &data, &size) < 0 || open_replay(&reader, data, size) < 0) {
+            printf("Cannot round-trip %s\n", path);
+            return 1;
+        }
+        const int seeks = 64;
+        uint32_t target = 12345;
+        int failed = 0;
+        Uint64 start = SDL_GetPerformanceCounter();
+        for (int j = 0; j < seeks; j++) {
+            target = target * 1103515245u + 12345u;
+            failed |= seek_replay(&reader, &game, target % reader.header.ticks) < 0;
+        }
+        double seconds = seconds_since(start);
+        printf("%9u %10u %10u %12zu %14.1f%s\n", interval, reader.header.ticks, reader.header.keyframeCount, size,
+               seconds / seeks * 1e6, failed ? "  FAILED" : "");
+        close_replay(&reader);
+        free(data);
+        free_replay_writer(&writer);
+    }
+    remove(path);
+    destroy_hamilton_agent(&agent);
+    destroy_game(&game);
+    return 0;
+}
+
+static int compare_double(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return x < y ? -1 : x > y;
+}
+
+static void print_latencies(const char *label, double *micros, int count, double seconds, long dropped, long spilled) {
+    qsort(micros, count, sizeof(double), compare_double);
+    printf("%-6s %10.1f %10.1f %10.1f %10.3f %8ld %8ld\n", label, micros[count / 2], micros[count * 99 / 100], micros[count - 1],
+           seconds, dropped, spilled);
+}
+
+// Game-thread cost of saving every finished game: a synchronous file per
+// replay against the spool under each backpressure policy. The spool gets a
+// small ring so the disk falls behind.
+static int bench_spool(int argc, char *argv[]) {
+    enum { RECORDINGS = 16 };
+    int games = argc > 0 ? atoi(argv[0]) : 2000;
+    if (games < 1) games = 2000;
+    static const char *prefix = "snake_bench_spool";
+    static const char *policies[] = {"drop", "block", "spill"};
+    ReplayWriter recordings[RECORDINGS] = {};
+    GameState game;
+    HamiltonAgent agent;
+    double *micros = (double *)malloc(sizeof(double) * games);
+    if (!micros || create_game(&game, 20, 20, 1) < 0 || create_hamilton_agent(&agent, 20, 20) < 0) {
+        return 1;
+    }
+    for (int i = 0; i < RECORDINGS; i++) {//full-board games, roughly 4 KB each
+        game.rng = (uint32_t)i + 1;
+        begin_replay(&recordings[i], &game, 1000);
+        initialize_game(&game);
+        while (!game.isGameOver) {
+            steer_snake(&game.snake, direction_movement(hamilton_agent_decide(&agent, &game)));
+            record_replay_tick(&recordings[i], &game);
+            step_game(&game);
+        }
+        end_replay(&recordings[i], &game);
+    }
+    printf("%d games of %zu bytes\n%-6s %10s %10s %10s %10s %8s %8s\n", games, encoded_replay_size(&recordings[0]),
+           "", "p50 us", "p99 us", "max us", "total s", "dropped", "spilled");
+    char path[512];
+    Uint64 start = SDL_GetPerformanceCounter();
+    for (int i = 0; i < games; i++) {
+        snprintf(path, sizeof(path), "%s-%d.snr", prefix, i);
+        Uint64 saveStart = SDL_GetPerformanceCounter();
+        save_replay(&recordings[i % RECORDINGS], path);
+        micros[i] = seconds_since(saveStart) * 1e6;
+    }
+    print_latencies("sync", micros, games, seconds_since(start), 0, 0);
+    for (int i = 0; i < games; i++) {
+        snprintf(path, sizeof(path), "%s-%d.snr", prefix, i);
+        remove(path);
+    }
+    for (int p = 0; p < 3; p++) {
+        ReplaySpool spool;
+        if (open_replay_spool(&spool, prefix, 64 << 10, 1 << 20, p) < 0) {
+            return 1;
+        }
+        start = SDL_GetPerformanceCounter();
+        for (int i = 0; i < games; i++) {
+            uint64_t hash;
+            Uint64 queueStart = SDL_GetPerformanceCounter();
+            spool_replay(&spool, &recordings[i % RECORDINGS], &hash);
+            micros[i] = seconds_since(queueStart) * 1e6;
+        }
+        close_replay_spool(&spool);//total includes draining the queue
+        print_latencies(policies[p], micros, games, seconds_since(start), SDL_AtomicGet(&spool.dropped), SDL_AtomicGet(&spool.spilled));
+        for (int n = 0; n <= spool.segmentNumber; n++) {
+            snprintf(path, sizeof(path), "%s-%d.snc", prefix, n);
+            remove(path);
+            snprintf(path, sizeof(path), "%s-%d.snc.idx", prefix, n);
+            remove(path);
+        }
+    }
+    for (int i = 0; i < RECORDINGS; i++) free_replay_writer(&recordings[i]);
+    free(micros);
+    destroy_hamilton_agent(&agent);
+    destroy_game(&game);
+    return 0;
+}
+
+// Compressed replays against the plain 2-bit format, per agent, over 20
+// games on 35x30: size, and how fast they encode and stream back next to
+// re-simulating the same games
+static int bench_codec(int argc, char *argv[]) {
+    static const char *defaultAgents[] = {"bfs", "hamilton"};
+    enum { GAMES = 20 };
+    int agentCount = argc > 0 ? argc : (int)(sizeof(defaultAgents) / sizeof(defaultAgents[0]));
+    GameState game;
+    if (create_game(&game, 35, 30, 1) < 0) {
+        return 1;
+    }
+    printf("%-9s %10s %11s %11s %7s %9s %12s %12s %12s\n", "agent", "ticks", "plain B", "coded B", "ratio", "bits/tick",
+           "encode t/s", "decode t/s", "simulate t/s");
+    for (int a = 0; a < agentCount; a++) {
+        const char *name = argc > 0 ? argv[a] : defaultAgents[a];
+        Agent agent;
+        if (create_agent(&agent, name, 35, 30) < 0) {
+            printf("%s: unknown agent\n", name);
+            continue;
+        }
+        unsigned char *plain[GAMES] = {}, *coded[GAMES] = {};
+        size_t plainSize[GAMES], codedSize[GAMES];
+        uint64_t ticks = 0, plainBytes = 0, codedBytes = 0;
+        for (int g = 0; g < GAMES; g++) {
+            ReplayWriter writer = {};
+            game.rng = (uint32_t)g + 1;
+            begin_replay(&writer, &game, 0);
+            initialize_game(&game);
+            while (!game.isGameOver && game.tick < 200000) {
+                steer_snake(&game.snake, direction_movement(agent_decide(&agent, &game)));
+                record_replay_tick(&writer, &game);
+                step_game(&game);
+            }
+            end_replay(&writer, &game);
+            plainSize[g] = encoded_replay_size(&writer);
+            plain[g] = (unsigned char *)malloc(plainSize[g]);
+            if (!plain[g]) return 1;
+            encode_replay(&writer, plain[g]);
+            ticks += writer.header.ticks;
+            plainBytes += (writer.header.ticks + 3) / 4;
+            free_replay_writer(&writer);
+        }
+        Uint64 start = SDL_GetPerformanceCounter();
+        for (int g = 0; g < GAMES; g++) {
+            if (compress_replay(plain[g], plainSize[g], &coded[g], &codedSize[g]) < 0) return 1;
+        }
+        double encodeSeconds = seconds_since(start);
+        int failed = 0;
+        int sink = 0;
+        start = SDL_GetPerformanceCounter();
+        for (int g = 0; g < GAMES; g++) {
+            ActionDecoder decoder;
+            failed |= open_action_decoder(&decoder, coded[g], codedSize[g]) < 0;
+            for (uint32_t t = 0; t < decoder.header.ticks; t++) sink += next_replay_action(&decoder);
+            failed |= decoder.failed;
+            codedBytes += get_u32(coded[g] + 12);
+        }
+        double decodeSeconds = seconds_since(start);
+        start = SDL_GetPerformanceCounter();
+        for (int g = 0; g < GAMES; g++) {
+            ReplayReader reader;
+            open_replay(&reader, plain[g], plainSize[g]);
+            failed |= verify_replay(&reader, &game) != REPLAY_VALID;
+        }
+        double simulateSeconds = seconds_since(start);
+        for (int g = 0; g < GAMES; g++) {//expanding must give back the exact file
+            unsigned char *expanded;
+            size_t expandedSize;
+            if (expand_replay(coded[g], codedSize[g], &expanded, &expandedSize) < 0) {
+                failed = 1;
+                continue;
+            }
+            failed |= expandedSize != plainSize[g] || memcmp(expanded, plain[g], expandedSize) != 0;
+            free(expanded);
+        }
+        printf("%-9s %10llu %11llu %11llu %6.1fx %9.3f %12.0f %12.0f %12.0f%s\n", name, (unsigned long long)ticks,
+               (unsigned long long)plainBytes, (unsigned long long)codedBytes, (double)plainBytes / codedBytes, codedBytes * 8.0 / ticks,
+               ticks / encodeSeconds, ticks / decodeSeconds, ticks / simulateSeconds, failed || sink < 0 ? "  FAILED" : "");
+        for (int g = 0; g < GAMES; g++) {
+            free(plain[g]);
+            free(coded[g]);
+        }
+        destroy_agent(&agent);
+    }
+    destroy_game(&game);
+    return 0;
+}
+
+// Checkpointing many live games: one save file for all of them, then every
+// game loaded back into a second set, which must save identically
+static int bench_save(int argc, char *argv[]) {
+    int count = argc > 0 ? atoi(argv[0]) : 1000;
+    if (count < 1) count = 1000;
+    static const char *path = "snake_bench_save.sav";
+    GameState *games = (GameState *)calloc(count, sizeof(GameState));
+    GameState *loaded = (GameState *)calloc(count, sizeof(GameState));
+    Agent agent;
+    if (!games || !loaded || create_agent(&agent, "bfs", 35, 30) < 0) {
+        return 1;
+    }
+    uint64_t ticks = 0;
+    for (int i = 0; i < count; i++) {//half under the poison rules, each stopped somewhere different
+        if (create_game(&games[i], 35, 30, (uint32_t)i + 1) < 0 || create_game(&loaded[i], 35, 30, 1) < 0) {
+            return 1;
+        }
+        games[i].rules = i % 2 ? poison_rules() : classic_rules();
+        initialize_game(&games[i]);
+        initialize_game(&loaded[i]);
+        uint32_t stop = (uint32_t)(i * 7919 % 3000);
+        while (!games[i].isGameOver && games[i].tick < stop) {
+            steer_snake(&games[i].snake, direction_movement(agent_decide(&agent, &games[i])));
+            step_game(&games[i]);
+        }
+        ticks += games[i].tick;
+    }
+    Uint64 start = SDL_GetPerformanceCounter();
+    int failed = save_games(path, games, count) < 0;
+    double saveSeconds = seconds_since(start);
+    unsigned char *data = NULL;
+    size_t size = 0, offset = SAVE_HEADER_SIZE;
+    uint32_t saved = 0;
+    start = SDL_GetPerformanceCounter();
+    failed |= load_games(path, &data, &size, &saved) < 0 || saved != (uint32_t)count;
+    for (int i = 0; !failed && i < count; i++) {
+        size_t used;
+        failed |= read_saved_game(&loaded[i], data + offset, size - offset, &used) < 0;
+        offset += used;
+    }
+    double loadSeconds = seconds_since(start);
+    for (int i = 0; !failed && i < count; i++) {
+        size_t bytes = saved_game_size(&games[i]);
+        unsigned char *before = (unsigned char *)malloc(bytes), *after = (unsigned char *)malloc(bytes);
+        write_saved_game(&games[i], before);
+        failed |= saved_game_size(&loaded[i]) != bytes;
+        if (!failed) {
+            write_saved_game(&loaded[i], after);
+            failed |= memcmp(before, after, bytes) != 0;
+        }
+        free(before);
+        free(after);
+    }
+    printf("%d games, %llu ticks played, %zu bytes\n%-5s %12s %10s\n", count, (unsigned long long)ticks, size, "", "games/s", "MB/s");
+    printf("%-5s %12.0f %10.1f\n", "save", count / saveSeconds, size / saveSeconds / 1e6);
+    printf("%-5s %12.0f %10.1f%s\n", "load", count / loadSeconds, size / loadSeconds / 1e6, failed ? "  FAILED" : "");
+    remove(path);
+    free(data);
+    for (int i = 0; i < count; i++) {
+        destroy_game(&games[i]);
+        destroy_game(&loaded[i]);
+    }
+    free(games);
+    free(loaded);
+    destroy_agent(&agent);
+    return failed;
+}
+
+typedef struct {
+    const char *name;
+    const char *usage;
+    int (*run)(int argc, char *argv[]);
+} Benchmark;
+
+static const Benchmark benchmarks[] = {
+    {"hamilton", "hamilton [size...]   full-board games with the Hamiltonian agent", bench_hamilton},
+    {"mcts", "mcts [threads...]    MCTS playouts per second from 1 to 64 threads", bench_mcts},
+    {"batch", "batch [games] [plugin] batched policy calls across many games", bench_batch},
+    {"reach", "reach [size]          incremental reachability against flood fill", bench_reach},
+    {"clone", "clone [length...]     game clone and snapshot throughput by snake length", bench_clone},
+    {"undo", "undo [depth]           depth-first search with step/undo against clones", bench_undo},
+    {"seek", "seek [interval...]     replay size and seek latency by keyframe interval", bench_seek},
+    {"spool", "spool [games]          game-thread replay saving cost, synchronous against the async writer", bench_spool},
+    {"codec", "codec [agent...]       compressed replay size and decode speed against the 2-bit format", bench_codec},
+    {"save", "save [games]           checkpointing live games to one save file and loading them back", bench_save},
+};
+
+int main(int argc, char *argv[]) {
+    int count = (int)(sizeof(benchmarks) / sizeof(benchmarks[0]));
+    for (int i = 0; argc > 1 && i < count; i++) {
+        if (strcmp(argv[1], benchmarks[i].name) == 0) {
+            return benchmarks[i].run(argc - 2, argv + 2);
+        }
+    }
+    printf("Usage: %s <benchmark> [args...]\n", argv[0]);
+    for (int i = 0; i < count; i++) {
+        printf("  %s\n", benchmarks[i].usage);
+    }
+    return 1;
+}
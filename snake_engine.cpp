@@ -0,0 +1,457 @@
+#include "snake_engine.h"
+#include "distance_field.h"
+#include <stdlib.h>
+#include <string.h>
+
+GameRules classic_rules(void) {
+    GameRules rules = {1, 5, 0, 0, 0};
+    return rules;
+}
+
+GameRules poison_rules(void) {
+    GameRules rules = {10, 50, 1, 10, 20};//task_302 gave poison 4 seconds, 20 ticks at the starting speed
+    return rules;
+}
+
+int find_rules(const char *name, GameRules *rules) {
+    if (strcmp(name, "classic") == 0) {
+        *rules = classic_rules();
+        return 0;
+    }
+    if (strcmp(name, "poison") == 0) {
+        *rules = poison_rules();
+        return 0;
+    }
+    return -1;
+}
+
+static int same_rules(const GameRules *a, const GameRules *b) {
+    return a->foodPoints == b->foodPoints && a->bonusPoints == b->bonusPoints && a->poisonEnabled == b->poisonEnabled
+        && a->poisonPenalty == b->poisonPenalty && a->poisonLifetime == b->poisonLifetime;
+}
+
+// The variant find_rules() would give these rules, NULL for any other
+// combination, which no game could have been played under
+const char *rules_name(const GameRules *rules) {
+    GameRules classic = classic_rules(), poison = poison_rules();
+    if (same_rules(rules, &classic)) return "classic";
+    if (same_rules(rules, &poison)) return "poison";
+    return NULL;
+}
+
+int create_game(GameState *game, int width, int height, uint32_t seed) {
+    memset(game, 0, sizeof(*game));
+    if (width < 2 || height < 1 || width > MAX_BOARD_CELLS / height) {//the starting snake is two cells wide
+        return -1;
+    }
+    game->width = width;
+    game->height = height;
+    game->rules = classic_rules();
+    game->snake.capacity = width * height;
+    game->snake.body = (Position *)malloc(sizeof(Position) * game->snake.capacity);
+    game->cells = (unsigned char *)calloc(width * height, 1);
+    game->rng = seed ? seed : 0x9e3779b9u; // xorshift must not start at zero
+    if (!game->snake.body || !game->cells) {
+        destroy_game(game);
+        return -1;
+    }
+    return 0;
+}
+
+void destroy_game(GameState *game) {
+    free(game->snake.body);
+    free(game->cells);
+    game->snake.body = NULL;
+    game->cells = NULL;
+}
+
+// Writes the segments head first into out, at most two contiguous runs of the ring
+static void copy_segments(Position *out, const SnakeGame *snake) {
+    int first = snake->capacity - snake->head;
+    if (first > snake->length) first = snake->length;
+    memcpy(out, snake->body + snake->head, sizeof(Position) * first);
+    memcpy(out + first, snake->body, sizeof(Position) * (snake->length - first));
+}
+
+// Setting a byte per segment beats rewriting the whole grid only for short
+// snakes; past this many segments per cell the grid is copied or cleared instead
+#define SEGMENTS_PER_GRID_COPY 16
+
+static void mark_segments(GameState *game, const Position *segments, int count, unsigned char value) {
+    for (int i = 0; i < count; i++) {
+        game->cells[segments[i].y * game->width + segments[i].x] = value;
+    }
+}
+
+// Removes the snake from the grid, the rest of the board is already empty
+static void clear_snake(GameState *game) {
+    const SnakeGame *snake = &game->snake;
+    int cellCount = game->width * game->height;
+    if (snake->length * SEGMENTS_PER_GRID_COPY >= cellCount) {
+        memset(game->cells, 0, cellCount);
+        return;
+    }
+    int first = snake->capacity - snake->head;
+    if (first > snake->length) first = snake->length;
+    mark_segments(game, snake->body + snake->head, first, 0);
+    mark_segments(game, snake->body, snake->length - first, 0);
+}
+
+// Both games must have been created with the same board size. Only the
+// live segments are copied and, while the snakes are short, only their cells
+// in the grid, so the cost follows the lengths rather than the board. The
+// destination keeps its own distance field, if any, and brings it up to date.
+void copy_game(GameState *destination, const GameState *source) {
+    Position *body = destination->snake.body;
+    unsigned char *cells = destination->cells;
+    DistanceField *field = destination->distanceField;
+    int cellCount = source->width * source->height;
+    int copyGrid = (destination->snake.length + source->snake.length) * SEGMENTS_PER_GRID_COPY >= cellCount;
+    if (!copyGrid) clear_snake(destination);
+    *destination = *source;
+    destination->snake.body = body;
+    destination->snake.head = 0;
+    destination->cells = cells;
+    destination->distanceField = field;
+    copy_segments(body, &source->snake);
+    if (copyGrid) {
+        memcpy(cells, source->cells, cellCount);
+    } else {
+        mark_segments(destination, body, source->snake.length, 1);
+    }
+    if (field && source->distanceField) {
+        memcpy(field->distance, source->distanceField->distance, sizeof(int) * source->width * source->height);
+    } else if (field) {
+        rebuild_distance_field(field, destination);
+    }
+}
+
+// The snapshot's buffers grow to the longest snake and the board it has held
+int save_snapshot(GameSnapshot *snapshot, const GameState *game) {
+    if (game->snake.length > snapshot->segmentCapacity) {
+        Position *segments = (Position *)realloc(snapshot->segments, sizeof(Position) * game->snake.length);
+        if (!segments) {
+            return -1;
+        }
+        snapshot->segments = segments;
+        snapshot->segmentCapacity = game->snake.length;
+    }
+    int cellCount = game->width * game->height;
+    snapshot->hasCells = game->snake.length * SEGMENTS_PER_GRID_COPY >= cellCount;
+    if (snapshot->hasCells && cellCount > snapshot->cellCapacity) {
+        unsigned char *cells = (unsigned char *)realloc(snapshot->cells, cellCount);
+        if (!cells) {
+            snapshot->hasCells = 0;
+            return -1;
+        }
+        snapshot->cells = cells;
+        snapshot->cellCapacity = cellCount;
+    }
+    snapshot->state = *game;
+    snapshot->state.snake.body = NULL;
+    snapshot->state.cells = NULL;
+    snapshot->state.distanceField = NULL;
+    copy_segments(snapshot->segments, &game->snake);
+    if (snapshot->hasCells) memcpy(snapshot->cells, game->cells, cellCount);
+    return 0;
+}
+
+// The game must have the board size the snapshot was taken on. Snapshots
+// built by hand, as the file loaders do, leave hasCells zero.
+void restore_snapshot(GameState *game, const GameSnapshot *snapshot) {
+    Position *body = game->snake.body;
+    unsigned char *cells = game->cells;
+    DistanceField *field = game->distanceField;
+    int cellCount = game->width * game->height;
+    int copyGrid = snapshot->hasCells || (game->snake.length + snapshot->state.snake.length) * SEGMENTS_PER_GRID_COPY >= cellCount;
+    if (!copyGrid) clear_snake(game);
+    *game = snapshot->state;
+    game->snake.body = body;
+    game->snake.head = 0;
+    game->cells = cells;
+    game->distanceField = field;
+    memcpy(body, snapshot->segments, sizeof(Position) * snapshot->state.snake.length);
+    if (snapshot->hasCells) {
+        memcpy(cells, snapshot->cells, cellCount);
+    } else {
+        if (copyGrid) memset(cells, 0, cellCount);
+        mark_segments(game, body, game->snake.length, 1);
+    }
+    if (field) {
+        rebuild_distance_field(field, game);
+    }
+}
+
+void free_snapshot(GameSnapshot *snapshot) {
+    free(snapshot->segments);
+    free(snapshot->cells);
+    snapshot->segments = NULL;
+    snapshot->cells = NULL;
+    snapshot->segmentCapacity = snapshot->cellCapacity = 0;
+    snapshot->hasCells = 0;
+}
+
+// Whether a snapshot read from a file is a state step_game() could have
+// reached on its board, so restoring it keeps the grid and the body in
+// agreement: a connected snake of distinct cells, active food on the board,
+// a speed the game runs at, a live PRNG and an end reason that matches
+// isGameOver. scratch is width * height zeroed bytes and is left zeroed.
+int check_snapshot(const GameSnapshot *snapshot, unsigned char *scratch) {
+    const GameState *state = &snapshot->state;
+    int length = state->snake.length, valid = 1, marked = 0;
+    if (length < 1 || length > state->width * state->height || state->speed < MIN_SPEED || state->speed > INITIAL_SPEED
+        || state->rng == 0 || state->endReason < GAME_RUNNING || state->endReason > END_BOARD_FULL
+        || (state->isGameOver != 0) != (state->endReason != GAME_RUNNING)
+        || (state->food.isActive && check_border_collision(state, state->food.location))
+        || (state->bonus.isActive && check_border_collision(state, state->bonus.location))
+        || (state->poison.isActive && check_border_collision(state, state->poison.location))) {
+        return 0;
+    }
+    for (; marked < length; marked++) {
+        Position segment = snapshot->segments[marked];
+        Position previous = snapshot->segments[marked ? marked - 1 : 0];
+        if (check_border_collision(state, segment) || (marked && abs(segment.x - previous.x) + abs(segment.y - previous.y) != 1)
+            || scratch[cell_index(state, segment)]) {
+            valid = 0;
+            break;
+        }
+        scratch[cell_index(state, segment)] = 1;
+    }
+    for (int i = 0; i < marked; i++) {
+        scratch[cell_index(state, snapshot->segments[i])] = 0;
+    }
+    return valid;
+}
+
+int game_random(GameState *game, int bound) {
+    uint32_t x = game->rng;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    game->rng = x;
+    return (int)(x % (uint32_t)bound);
+}
+
+void initialize_game(GameState *game) {
+    SnakeGame *snake = &game->snake;
+    memset(game->cells, 0, game->width * game->height);
+    snake->length = 2;
+    snake->head = 0;
+    snake->movement = (Position){1, 0};
+    for (int i = 0; i < snake->length; i++) {
+        snake->body[i] = (Position){snake->length - i - 1, 0}; //(1,0),(0,0)
+        game->cells[cell_index(game, snake->body[i])] = 1;
+    }
+    game->bonus.isActive = 0;
+    game->poison.isActive = 0;
+    game->score = 0;
+    game->speed = INITIAL_SPEED;
+    game->foodConsumed = 0;
+    game->isGameOver = 0;
+    game->endReason = GAME_RUNNING;
+    game->tick = 0;
+    spawn_new_food(game);
+}
+
+Position direction_movement(int direction) {
+    static const Position movements[4] = {{0, -1}, {0, 1}, {-1, 0}, {1, 0}};
+    return movements[direction & 3];
+}
+
+int movement_direction(Position movement) {
+    if (movement.y < 0) return DIRECTION_UP;
+    if (movement.y > 0) return DIRECTION_DOWN;
+    return movement.x < 0 ? DIRECTION_LEFT : DIRECTION_RIGHT;
+}
+
+void steer_snake(SnakeGame *snake, Position movement) {//only quarter turns, the snake cannot reverse into its own neck
+    if ((movement.x != 0 && snake->movement.x == 0) || (movement.y != 0 && snake->movement.y == 0)) {
+        snake->movement = movement;
+    }
+}
+
+int check_border_collision(const GameState *game, Position p) {
+    return p.x < 0 || p.x >= game->width || p.y < 0 || p.y >= game->height;
+}
+
+int check_self_collision(const GameState *game, Position p) {
+    return game->cells[cell_index(game, p)];
+}
+
+static Position random_free_cell(GameState *game) {
+    int cellCount = game->width * game->height;
+    for (int attempt = 0; attempt < 64; attempt++) {
+        Position p = {game_random(game, game->width), game_random(game, game->height)};
+        if (!check_self_collision(game, p)) {
+            return p;
+        }
+    }
+    // Crowded board: pick uniformly among the free cells instead of retrying forever
+    int skip = game_random(game, cellCount - game->snake.length);
+    for (int i = 0; i < cellCount; i++) {
+        if (!game->cells[i] && skip-- == 0) {
+            return (Position){i % game->width, i / game->width};
+        }
+    }
+    return (Position){0, 0};
+}
+
+int spawn_new_food(GameState *game) {
+    if (game->snake.length == game->width * game->height) {
+        game->food.isActive = 0;//board is full, nothing left to eat
+        game->isGameOver = 1;
+        game->endReason = END_BOARD_FULL;
+        if (game->distanceField) rebuild_distance_field(game->distanceField, game);
+        return -1;
+    }
+    game->food.location = random_free_cell(game);//normal food
+    game->food.isActive = 1;
+    if (game->distanceField) rebuild_distance_field(game->distanceField, game);
+
+    if (game->rules.poisonEnabled && game->foodConsumed >= 4) {
+        game->poison.location = (Position){game_random(game, game->width), game_random(game, game->height)};
+        game->poison.isActive = 1;
+        game->poison.spawnTick = game->tick;
+    }
+
+    if (game->foodConsumed >= 5) {
+        game->bonus.location = (Position){game_random(game, game->width), game_random(game, game->height)};//bonus food
+        game->bonus.isActive = 1;
+        game->foodConsumed = 0;
+    }
+
+    return 0;
+}
+
+int step_game(GameState *game) {
+    if (game->isGameOver) {
+        return 0;
+    }
+    SnakeGame *snake = &game->snake;
+    Position head = snake_segment(snake, 0);
+    Position next = {head.x + snake->movement.x, head.y + snake->movement.y};
+    game->tick++;
+
+    if (check_border_collision(game, next)) {
+        game->isGameOver = 1;
+        game->endReason = END_BORDER;
+        return STEP_DIED;
+    }
+
+    int eats = game->food.isActive && next.x == game->food.location.x && next.y == game->food.location.y;
+    int tailCell = cell_index(game, snake_segment(snake, snake->length - 1));
+    if (!eats) {
+        game->cells[tailCell] = 0;//tail moves out of the way in the same tick
+    }
+    if (check_self_collision(game, next)) {
+        game->cells[tailCell] = 1;
+        game->isGameOver = 1;
+        game->endReason = END_SELF;
+        return STEP_DIED;
+    }
+
+    snake->head = snake->head ? snake->head - 1 : snake->capacity - 1;
+    snake->body[snake->head] = next;
+    int nextCell = cell_index(game, next);
+    game->cells[nextCell] = 1;
+    if (game->distanceField && !eats && nextCell != tailCell) {//eating moves the food, which rebuilds the field
+        game->cells[tailCell] = 1;//take the head cell first, then free the tail
+        distance_field_cell_taken(game->distanceField, game, nextCell);
+        game->cells[tailCell] = 0;
+        distance_field_cell_freed(game->distanceField, game, tailCell);
+    }
+
+    int events = 0;
+    if (game->poison.isActive && next.x == game->poison.location.x && next.y == game->poison.location.y) {
+        game->score -= game->rules.poisonPenalty;
+        game->poison.isActive = 0;
+        events |= STEP_ATE_POISON;
+        if (game->score < 0) {
+            game->isGameOver = 1;
+            game->endReason = END_POISON;
+            return events | STEP_DIED;
+        }
+    }
+
+    if (eats) {
+        snake->length++;
+        game->score += game->rules.foodPoints;
+        game->foodConsumed++;
+        if (game->speed > MIN_SPEED) game->speed -= 5; // Increase speed after eating food REDUCE GAME SPEED BY 5 SEC
+        spawn_new_food(game);
+        events |= STEP_ATE_FOOD;
+    }
+
+    if (game->bonus.isActive && next.x == game->bonus.location.x && next.y == game->bonus.location.y) {
+        game->score += game->rules.bonusPoints;  // Extra points from bonus food
+        game->bonus.isActive = 0;
+        events |= STEP_ATE_BONUS;
+    }
+
+    if (game->poison.isActive && game->tick - game->poison.spawnTick > (uint32_t)game->rules.poisonLifetime) {
+        game->poison.isActive = 0;
+    }
+    return events;
+}
+
+// Steers and steps like the game loop does, recording the delta in undo
+int step_game_undoable(GameState *game, Position movement, StepUndo *undo) {
+    SnakeGame *snake = &game->snake;
+    int head = snake->head, length = snake->length;
+    undo->movement = snake->movement;
+    undo->tail = snake_segment(snake, length - 1);
+    undo->food = game->food;
+    undo->bonus = game->bonus;
+    undo->poison = game->poison;
+    undo->score = game->score;
+    undo->speed = game->speed;
+    undo->foodConsumed = game->foodConsumed;
+    undo->isGameOver = game->isGameOver;
+    undo->endReason = game->endReason;
+    undo->tick = game->tick;
+    undo->rng = game->rng;
+    steer_snake(snake, movement);
+    int events = step_game(game);
+    undo->moved = snake->head != head;
+    undo->grew = snake->length != length;
+    return events;
+}
+
+// Undo records must be applied newest first, each against the state its own tick produced
+void undo_step(GameState *game, const StepUndo *undo) {
+    SnakeGame *snake = &game->snake;
+    DistanceField *field = game->distanceField;
+    if (undo->moved) {
+        int headCell = cell_index(game, snake_segment(snake, 0));
+        int tailCell = cell_index(game, undo->tail);
+        snake->head = snake->head + 1 == snake->capacity ? 0 : snake->head + 1;
+        if (undo->grew) {
+            snake->length--;
+            game->cells[headCell] = 0;
+        } else {
+            int tailSlot = snake->head + snake->length - 1;
+            snake->body[tailSlot >= snake->capacity ? tailSlot - snake->capacity : tailSlot] = undo->tail;//later ticks may have reused the slot
+            if (headCell != tailCell) {
+                game->cells[tailCell] = 1;//tail back first, then the head leaves, the reverse of step_game
+                if (field) distance_field_cell_taken(field, game, tailCell);
+                game->cells[headCell] = 0;
+                if (field) distance_field_cell_freed(field, game, headCell);
+            }
+        }
+    }
+    snake->movement = undo->movement;
+    int foodMoved = game->food.isActive != undo->food.isActive || game->food.location.x != undo->food.location.x || game->food.location.y != undo->food.location.y;
+    game->food = undo->food;
+    game->bonus = undo->bonus;
+    game->poison = undo->poison;
+    game->score = undo->score;
+    game->speed = undo->speed;
+    game->foodConsumed = undo->foodConsumed;
+    game->isGameOver = undo->isGameOver;
+    game->endReason = undo->endReason;
+    game->tick = undo->tick;
+    game->rng = undo->rng;
+    if (field && foodMoved) {
+        rebuild_distance_field(field, game);
+    }
+}
@@ -0,0 +1,144 @@
+#ifndef SNAKE_ENGINE_H
+#define SNAKE_ENGINE_H
+
+#include <stdint.h>
+
+// Game rules without any SDL dependency, shared by the windowed game and the
+// headless modes. The board is measured in cells, not pixels.
+
+#define INITIAL_SPEED 200
+#define MIN_SPEED 50            // eating stops speeding the game up here
+#define MAX_BOARD_CELLS (1 << 20)   // create_game() refuses bigger boards, every per-cell array stays well inside int
+#define RULES_VERSION 1     // bump whenever a seed and the same inputs could play out differently
+
+// step_game() result flags
+#define STEP_ATE_FOOD 1
+#define STEP_ATE_BONUS 2
+#define STEP_DIED 4
+#define STEP_ATE_POISON 8
+
+// Why the game ended, GAME_RUNNING while it has not
+enum { GAME_RUNNING, END_BORDER, END_SELF, END_POISON, END_BOARD_FULL };
+
+// Directions in the order the arrow keys are handled; also the action encoding agents return
+enum { DIRECTION_UP, DIRECTION_DOWN, DIRECTION_LEFT, DIRECTION_RIGHT };
+
+typedef struct {
+    int x, y;
+} Position;
+
+typedef struct {
+    Position *body;     // ring buffer, segment i lives at body[(head + i) % capacity]
+    int head;
+    int capacity;       // one slot per board cell
+    int length;
+    Position movement;
+} SnakeGame;
+
+typedef struct {
+    Position location;
+    int isActive;
+} RegularFood;
+
+typedef struct {
+    Position location;
+    int isActive;
+} BonusFood;
+
+typedef struct {
+    Position location;
+    int isActive;
+    uint32_t spawnTick;     // poison disappears poisonLifetime ticks after this
+} PoisonFood;
+
+// Scoring and food variants; classic is the main game, poison the task_302 rules
+typedef struct {
+    int foodPoints;
+    int bonusPoints;
+    int poisonEnabled;
+    int poisonPenalty;      // a negative score after eating poison ends the game
+    int poisonLifetime;     // ticks
+} GameRules;
+
+struct DistanceField;
+
+typedef struct {
+    int width, height;
+    GameRules rules;
+    SnakeGame snake;
+    RegularFood food;
+    BonusFood bonus;
+    PoisonFood poison;
+    unsigned char *cells;   // width * height, 1 where a snake segment is
+    int score, speed, foodConsumed;
+    int isGameOver;
+    int endReason;
+    uint32_t tick;
+    uint32_t rng;
+    struct DistanceField *distanceField;   // optional, see distance_field.h
+} GameState;
+
+// A game stored as the scalars plus the segments, head first, so saving and
+// restoring cost follows the snake's length. Once the snake is long enough
+// that copying the grid is cheaper than marking its cells, as in copy_game(),
+// the grid is kept too. Zero initialise before the first save_snapshot().
+typedef struct {
+    GameState state;        // its pointers are not used
+    Position *segments;
+    int segmentCapacity;
+    unsigned char *cells;   // the board, valid while hasCells
+    int cellCapacity;
+    int hasCells;
+} GameSnapshot;
+
+// What one tick changed, enough for undo_step() to rewind it in constant time
+typedef struct {
+    Position movement;      // before steering
+    Position tail;          // cell the tail left when the snake moved without growing
+    RegularFood food;
+    BonusFood bonus;
+    PoisonFood poison;
+    int score, speed, foodConsumed;
+    int isGameOver, endReason;
+    uint32_t tick;
+    uint32_t rng;           // food spawns draw from it
+    unsigned char moved, grew;
+} StepUndo;
+
+GameRules classic_rules(void);
+GameRules poison_rules(void);
+int find_rules(const char *name, GameRules *rules);
+const char *rules_name(const GameRules *rules);
+
+int create_game(GameState *game, int width, int height, uint32_t seed);
+void destroy_game(GameState *game);
+void initialize_game(GameState *game);
+void copy_game(GameState *destination, const GameState *source);
+int save_snapshot(GameSnapshot *snapshot, const GameState *game);
+void restore_snapshot(GameState *game, const GameSnapshot *snapshot);
+void free_snapshot(GameSnapshot *snapshot);
+int check_snapshot(const GameSnapshot *snapshot, unsigned char *scratch);
+
+int game_random(GameState *game, int bound);
+
+static inline Position snake_segment(const SnakeGame *snake, int i) {
+    int index = snake->head + i;
+    if (index >= snake->capacity) index -= snake->capacity;
+    return snake->body[index];
+}
+
+static inline int cell_index(const GameState *game, Position p) {
+    return p.y * game->width + p.x;
+}
+
+Position direction_movement(int direction);
+int movement_direction(Position movement);
+void steer_snake(SnakeGame *snake, Position movement);
+int check_border_collision(const GameState *game, Position p);
+int check_self_collision(const GameState *game, Position p);
+int spawn_new_food(GameState *game);
+int step_game(GameState *game);
+int step_game_undoable(GameState *game, Position movement, StepUndo *undo);
+void undo_step(GameState *game, const StepUndo *undo);
+
+#endif
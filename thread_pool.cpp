@@ -0,0 +1,166 @@
+#include "thread_pool.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define TASK_DEQUE_CAPACITY 1024
+
+static thread_local Worker *currentWorker = NULL;
+
+static int deque_push(TaskDeque *deque, Task task) {
+    SDL_LockMutex(deque->lock);
+    int pushed = deque->bottom - deque->top < TASK_DEQUE_CAPACITY;
+    if (pushed) {
+        deque->tasks[deque->bottom % TASK_DEQUE_CAPACITY] = task;
+        deque->bottom++;
+    }
+    SDL_UnlockMutex(deque->lock);
+    return pushed;
+}
+
+static int deque_pop(TaskDeque *deque, Task *task) {
+    SDL_LockMutex(deque->lock);
+    int popped = deque->bottom > deque->top;
+    if (popped) {
+        deque->bottom--;
+        *task = deque->tasks[deque->bottom % TASK_DEQUE_CAPACITY];
+    }
+    SDL_UnlockMutex(deque->lock);
+    return popped;
+}
+
+static int deque_steal(TaskDeque *deque, Task *task) {
+    SDL_LockMutex(deque->lock);
+    int stolen = deque->bottom > deque->top;
+    if (stolen) {
+        *task = deque->tasks[deque->top % TASK_DEQUE_CAPACITY];
+        deque->top++;
+    }
+    SDL_UnlockMutex(deque->lock);
+    return stolen;
+}
+
+static int find_task(Worker *worker, Task *task) {
+    ThreadPool *pool = worker->pool;
+    if (deque_pop(&pool->deques[worker->index], task)) {
+        return 1;
+    }
+    for (int i = 1; i < pool->threadCount; i++) {
+        if (deque_steal(&pool->deques[(worker->index + i) % pool->threadCount], task)) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static void finish_task(ThreadPool *pool) {
+    if (SDL_AtomicAdd(&pool->pending, -1) == 1) {
+        SDL_LockMutex(pool->idleLock);
+        SDL_CondBroadcast(pool->allDone);
+        SDL_UnlockMutex(pool->idleLock);
+    }
+}
+
+static int worker_main(void *data) {
+    Worker *worker = (Worker *)data;
+    ThreadPool *pool = worker->pool;
+    currentWorker = worker;
+    while (1) {
+        SDL_LockMutex(pool->idleLock);
+        while (SDL_AtomicGet(&pool->queued) == 0 && !pool->shuttingDown) {
+            SDL_CondWait(pool->workAvailable, pool->idleLock);
+        }
+        int stop = pool->shuttingDown && SDL_AtomicGet(&pool->queued) == 0;
+        SDL_UnlockMutex(pool->idleLock);
+        if (stop) {
+            return 0;
+        }
+        Task task;
+        while (find_task(worker, &task)) {
+            SDL_AtomicAdd(&pool->queued, -1);
+            task.run(task.arg);
+            finish_task(pool);
+        }
+    }
+}
+
+int create_thread_pool(ThreadPool *pool, int threadCount) {
+    memset(pool, 0, sizeof(*pool));
+    pool->threadCount = threadCount > 0 ? threadCount : 1;
+    pool->threads = (SDL_Thread **)calloc(pool->threadCount, sizeof(SDL_Thread *));
+    pool->workers = (Worker *)calloc(pool->threadCount, sizeof(Worker));
+    pool->deques = (TaskDeque *)calloc(pool->threadCount, sizeof(TaskDeque));
+    pool->idleLock = SDL_CreateMutex();
+    pool->workAvailable = SDL_CreateCond();
+    pool->allDone = SDL_CreateCond();
+    if (!pool->threads || !pool->workers || !pool->deques || !pool->idleLock || !pool->workAvailable || !pool->allDone) {
+        destroy_thread_pool(pool);
+        return -1;
+    }
+    for (int i = 0; i < pool->threadCount; i++) {
+        pool->deques[i].tasks = (Task *)malloc(sizeof(Task) * TASK_DEQUE_CAPACITY);
+        pool->deques[i].lock = SDL_CreateMutex();
+        if (!pool->deques[i].tasks || !pool->deques[i].lock) {
+            destroy_thread_pool(pool);
+            return -1;
+        }
+    }
+    for (int i = 0; i < pool->threadCount; i++) {
+        pool->workers[i] = (Worker){pool, i};
+        pool->threads[i] = SDL_CreateThread(worker_main, "pool worker", &pool->workers[i]);
+        if (!pool->threads[i]) {
+            destroy_thread_pool(pool);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+void destroy_thread_pool(ThreadPool *pool) {
+    if (pool->idleLock) {
+        SDL_LockMutex(pool->idleLock);
+        pool->shuttingDown = 1;
+        SDL_CondBroadcast(pool->workAvailable);
+        SDL_UnlockMutex(pool->idleLock);
+    }
+    for (int i = 0; pool->threads && i < pool->threadCount; i++) {
+        SDL_WaitThread(pool->threads[i], NULL);
+    }
+    for (int i = 0; pool->deques && i < pool->threadCount; i++) {
+        free(pool->deques[i].tasks);
+        if (pool->deques[i].lock) SDL_DestroyMutex(pool->deques[i].lock);
+    }
+    if (pool->idleLock) SDL_DestroyMutex(pool->idleLock);
+    if (pool->workAvailable) SDL_DestroyCond(pool->workAvailable);
+    if (pool->allDone) SDL_DestroyCond(pool->allDone);
+    free(pool->threads);
+    free(pool->workers);
+    free(pool->deques);
+    memset(pool, 0, sizeof(*pool));
+}
+
+void submit_task(ThreadPool *pool, TaskFunction run, void *arg) {
+    Task task = {run, arg};
+    SDL_AtomicAdd(&pool->pending, 1);
+    // Work spawned by a worker stays on its own deque until someone steals it
+    int first = currentWorker && currentWorker->pool == pool ? currentWorker->index : SDL_AtomicAdd(&pool->nextDeque, 1) % pool->threadCount;
+    if (first < 0) first += pool->threadCount;
+    for (int i = 0; i < pool->threadCount; i++) {
+        if (deque_push(&pool->deques[(first + i) % pool->threadCount], task)) {
+            SDL_LockMutex(pool->idleLock);
+            SDL_AtomicAdd(&pool->queued, 1);
+            SDL_CondSignal(pool->workAvailable);
+            SDL_UnlockMutex(pool->idleLock);
+            return;
+        }
+    }
+    run(arg);//every deque is full, run it here rather than drop it
+    finish_task(pool);
+}
+
+void wait_thread_pool(ThreadPool *pool) {
+    SDL_LockMutex(pool->idleLock);
+    while (SDL_AtomicGet(&pool->pending) > 0) {
+        SDL_CondWait(pool->allDone, pool->idleLock);
+    }
+    SDL_UnlockMutex(pool->idleLock);
+}
@@ -0,0 +1,50 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <SDL2/SDL.h>
+
+// Fixed set of SDL worker threads with one task deque each. A worker runs
+// its own newest task first and steals the oldest task of another worker
+// when it runs dry, so tasks that submit follow-up work keep their data hot
+// while idle threads still pick up the slack.
+
+typedef void (*TaskFunction)(void *arg);
+
+typedef struct {
+    TaskFunction run;
+    void *arg;
+} Task;
+
+typedef struct {
+    Task *tasks;        // ring of TASK_DEQUE_CAPACITY entries
+    int top, bottom;    // steal from top, owner pushes and pops at bottom
+    SDL_mutex *lock;
+} TaskDeque;
+
+typedef struct ThreadPool ThreadPool;
+
+typedef struct {
+    ThreadPool *pool;
+    int index;
+} Worker;
+
+struct ThreadPool {
+    int threadCount;
+    SDL_Thread **threads;
+    Worker *workers;
+    TaskDeque *deques;
+    SDL_mutex *idleLock;
+    SDL_cond *workAvailable;
+    SDL_cond *allDone;
+    SDL_atomic_t queued;    // tasks sitting in deques
+    SDL_atomic_t pending;   // tasks submitted but not finished
+    SDL_atomic_t nextDeque; // round robin target for submissions from outside the pool
+    int shuttingDown;
+};
+
+int create_thread_pool(ThreadPool *pool, int threadCount);
+void destroy_thread_pool(ThreadPool *pool);
+void submit_task(ThreadPool *pool, TaskFunction run, void *arg);
+void wait_thread_pool(ThreadPool *pool);
+
+#endif
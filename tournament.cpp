@@ -0,0 +1,431 @@
+#include <SDL2/SDL.h>
+#include <limits.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "snake_engine.h"
+#include "agent.h"
+#include "distance_field.h"
+#include "score_log.h"
+
+// Self-play tournament: every agent plays the same seeded games under every
+// rule variant, spread over all cores, and the aggregate statistics are
+// written as CSV or JSON.
+// Usage: tournament [--agents bfs,hamilton] [--rules classic,poison] [--games N]
+//                   [--board WxH] [--seed S] [--threads T] [--max-ticks N]
+//                   [--format csv|json] [--output file] [--scores base]
+
+#define MAX_ENTRIES 32
+#define MAX_THREADS 256
+#define GAMES_PER_CLAIM 16  // games a worker takes at once, keeps the shared counter cold
+#define END_TIMEOUT GAME_RUNNING    // still alive at --max-ticks
+
+typedef struct {
+    char agentName[64];
+    char rulesName[32];
+    GameRules rules;
+} Entry;
+
+typedef struct {
+    long *counts;   // counts[value + offset]
+    int offset;     // scores go negative under the poison rules
+    int size;
+} Histogram;
+
+typedef struct {
+    long games;
+    uint64_t ticks;
+    double seconds;     // worker time spent on this entry
+    double scoreSum, scoreSquares;
+    long ends[END_BOARD_FULL + 1];
+    Histogram scores, lengths;
+} EntryStats;
+
+typedef struct {
+    Entry entries[MAX_ENTRIES];
+    int entryCount;
+    long gamesPerEntry;
+    int width, height;
+    uint32_t seed;
+    long maxTicks;
+    int mctsThreads;        // search pool per worker's MCTS agent, 0 to leave it as named
+    SDL_atomic_t nextGame;
+    ScoreLog *scores;       // every game's result when --scores is given
+    SDL_mutex *scoresLock;
+} Tournament;
+
+typedef struct {
+    Tournament *tournament;
+    EntryStats stats[MAX_ENTRIES];
+    int failed;
+} Worker;
+
+static int histogram_add(Histogram *histogram, int value, long count) {
+    int index = value + histogram->offset;
+    if (index < 0) {//shift everything up so the new minimum fits
+        int grow = -index;
+        long *counts = (long *)realloc(histogram->counts, sizeof(long) * (histogram->size + grow));
+        if (!counts) return -1;
+        memmove(counts + grow, counts, sizeof(long) * histogram->size);
+        memset(counts, 0, sizeof(long) * grow);
+        histogram->counts = counts;
+        histogram->size += grow;
+        histogram->offset += grow;
+        index = 0;
+    }
+    if (index >= histogram->size) {
+        int size = histogram->size ? histogram->size : 64;
+        while (size <= index) size *= 2;
+        long *counts = (long *)realloc(histogram->counts, sizeof(long) * size);
+        if (!counts) return -1;
+        memset(counts + histogram->size, 0, sizeof(long) * (size - histogram->size));
+        histogram->counts = counts;
+        histogram->size = size;
+    }
+    histogram->counts[index] += count;
+    return 0;
+}
+
+static int histogram_merge(Histogram *into, const Histogram *from) {
+    for (int i = 0; i < from->size; i++) {
+        if (from->counts[i] && histogram_add(into, i - from->offset, from->counts[i]) < 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+// Smallest value with at least fraction of the samples at or below it
+static int histogram_percentile(const Histogram *histogram, long total, double fraction) {
+    long target = (long)ceil(fraction * total);
+    if (target < 1) target = 1;
+    long seen = 0;
+    for (int i = 0; i < histogram->size; i++) {
+        seen += histogram->counts[i];
+        if (seen >= target) return i - histogram->offset;
+    }
+    return 0;
+}
+
+static int histogram_min(const Histogram *histogram) {
+    for (int i = 0; i < histogram->size; i++) {
+        if (histogram->counts[i]) return i - histogram->offset;
+    }
+    return 0;
+}
+
+static int histogram_max(const Histogram *histogram) {
+    for (int i = histogram->size - 1; i >= 0; i--) {
+        if (histogram->counts[i]) return i - histogram->offset;
+    }
+    return 0;
+}
+
+static double histogram_mean(const Histogram *histogram, long total) {
+    double sum = 0;
+    for (int i = 0; i < histogram->size; i++) {
+        sum += (double)histogram->counts[i] * (i - histogram->offset);
+    }
+    return total ? sum / total : 0;
+}
+
+// MCTS searches on a thread pool of its own. With several workers the cores
+// are split between their pools, else every worker would start one per core.
+static void worker_agent_name(const Tournament *tournament, const char *name, char *out, size_t size) {
+    snprintf(out, size, "%s", name);
+    if (tournament->mctsThreads && (strcmp(name, "mcts") == 0 || strncmp(name, "mcts:", 5) == 0)) {
+        int threads = name[4] == ':' && atoi(name + 5) > 0 ? atoi(name + 5) : tournament->mctsThreads;
+        snprintf(out, size, "mcts:%d", threads < tournament->mctsThreads ? threads : tournament->mctsThreads);
+    }
+}
+
+static int worker_main(void *data) {
+    Worker *worker = (Worker *)data;
+    Tournament *tournament = worker->tournament;
+    Agent agents[MAX_ENTRIES] = {};
+    char agentNames[MAX_ENTRIES][64];  // agents keep a pointer to their name
+    GameState game;
+    DistanceField foodDistance;
+    if (create_game(&game, tournament->width, tournament->height, 1) < 0) {
+        worker->failed = 1;
+        return 1;
+    }
+    if (create_distance_field(&foodDistance, game.width, game.height) < 0) {
+        destroy_game(&game);
+        worker->failed = 1;
+        return 1;
+    }
+    game.distanceField = &foodDistance;
+    long total = tournament->gamesPerEntry * tournament->entryCount;
+    for (;;) {
+        long first = SDL_AtomicAdd(&tournament->nextGame, GAMES_PER_CLAIM);
+        if (first >= total) break;
+        long last = first + GAMES_PER_CLAIM < total ? first + GAMES_PER_CLAIM : total;
+        ScoreRecord results[GAMES_PER_CLAIM];
+        for (long i = first; i < last; i++) {
+            int e = (int)(i / tournament->gamesPerEntry);
+            const Entry *entry = &tournament->entries[e];
+            EntryStats *stats = &worker->stats[e];
+            if (!agents[e].decide) {
+                worker_agent_name(tournament, entry->agentName, agentNames[e], sizeof(agentNames[e]));
+                if (create_agent(&agents[e], agentNames[e], game.width, game.height) < 0) {
+                    worker->failed = 1;
+                    break;
+                }
+            }
+            // Game n uses the same seed for every entry, so agents face identical food sequences
+            uint32_t seed = tournament->seed + (uint32_t)(i % tournament->gamesPerEntry);
+            game.rng = seed ? seed : 0x9e3779b9u;
+            game.rules = entry->rules;
+            initialize_game(&game);
+            Uint64 start = SDL_GetPerformanceCounter();
+            while (!game.isGameOver && game.tick < (uint32_t)tournament->maxTicks) {
+                steer_snake(&game.snake, direction_movement(agent_decide(&agents[e], &game)));
+                step_game(&game);
+            }
+            stats->seconds += (double)(SDL_GetPerformanceCounter() - start) / (double)SDL_GetPerformanceFrequency();
+            stats->games++;
+            stats->ticks += game.tick;
+            stats->scoreSum += game.score;
+            stats->scoreSquares += (double)game.score * game.score;
+            stats->ends[game.endReason]++;
+            if (histogram_add(&stats->scores, game.score, 1) < 0 || histogram_add(&stats->lengths, game.snake.length, 1) < 0) {
+                worker->failed = 1;
+            }
+            results[i - first] = (ScoreRecord){game.score, game.snake.length, seed, (uint64_t)time(NULL), 0};
+        }
+        if (tournament->scores && !worker->failed) {//one lock per claim, the log batches its own fsyncs
+            SDL_LockMutex(tournament->scoresLock);
+            for (long i = first; i < last; i++) {
+                if (append_score(tournament->scores, &results[i - first]) < 0) worker->failed = 1;
+            }
+            SDL_UnlockMutex(tournament->scoresLock);
+        }
+        if (worker->failed) break;
+    }
+    for (int e = 0; e < tournament->entryCount; e++) {
+        if (agents[e].decide) destroy_agent(&agents[e]);
+    }
+    destroy_distance_field(&foodDistance);
+    destroy_game(&game);
+    return worker->failed;
+}
+
+static void write_csv(FILE *out, const Tournament *tournament, const EntryStats *totals) {
+    fprintf(out, "agent,rules,games,score_mean,score_stddev,score_min,score_p10,score_p50,score_p90,score_p99,score_max,"
+                 "length_mean,length_p50,length_max,border,self,poison,board_full,timeout,ticks,steps_per_core_second\n");
+    for (int e = 0; e < tournament->entryCount; e++) {
+        const EntryStats *s = &totals[e];
+        double mean = s->games ? s->scoreSum / s->games : 0;
+        double variance = s->games ? s->scoreSquares / s->games - mean * mean : 0;
+        fprintf(out, "%s,%s,%ld,%.3f,%.3f,%d,%d,%d,%d,%d,%d,%.3f,%d,%d,%ld,%ld,%ld,%ld,%ld,%llu,%.0f\n",
+                tournament->entries[e].agentName, tournament->entries[e].rulesName, s->games,
+                mean, sqrt(variance > 0 ? variance : 0), histogram_min(&s->scores),
+                histogram_percentile(&s->scores, s->games, 0.10), histogram_percentile(&s->scores, s->games, 0.50),
+                histogram_percentile(&s->scores, s->games, 0.90), histogram_percentile(&s->scores, s->games, 0.99),
+                histogram_max(&s->scores), histogram_mean(&s->lengths, s->games),
+                histogram_percentile(&s->lengths, s->games, 0.50), histogram_max(&s->lengths),
+                s->ends[END_BORDER], s->ends[END_SELF], s->ends[END_POISON], s->ends[END_BOARD_FULL], s->ends[END_TIMEOUT],
+                (unsigned long long)s->ticks, s->seconds > 0 ? s->ticks / s->seconds : 0);
+    }
+}
+
+static void write_histogram_json(FILE *out, const char *name, const Histogram *histogram) {
+    fprintf(out, "\"%s\": [", name);
+    int first = 1;
+    for (int i = 0; i < histogram->size; i++) {
+        if (!histogram->counts[i]) continue;
+        fprintf(out, "%s[%d, %ld]", first ? "" : ", ", i - histogram->offset, histogram->counts[i]);
+        first = 0;
+    }
+    fprintf(out, "]");
+}
+
+static void write_json(FILE *out, const Tournament *tournament, const EntryStats *totals, int threads, double seconds) {
+    uint64_t ticks = 0;
+    for (int e = 0; e < tournament->entryCount; e++) ticks += totals[e].ticks;
+    fprintf(out, "{\"board\": [%d, %d], \"seed\": %u, \"games_per_entry\": %ld, \"max_ticks\": %ld, "
+                 "\"threads\": %d, \"seconds\": %.3f, \"steps_per_second\": %.0f, \"entries\": [",
+            tournament->width, tournament->height, tournament->seed, tournament->gamesPerEntry, tournament->maxTicks,
+            threads, seconds, seconds > 0 ? ticks / seconds : 0);
+    for (int e = 0; e < tournament->entryCount; e++) {
+        const EntryStats *s = &totals[e];
+        double mean = s->games ? s->scoreSum / s->games : 0;
+        double variance = s->games ? s->scoreSquares / s->games - mean * mean : 0;
+        fprintf(out, "%s\n  {\"agent\": \"%s\", \"rules\": \"%s\", \"games\": %ld, \"ticks\": %llu, ",
+                e ? "," : "", tournament->entries[e].agentName, tournament->entries[e].rulesName, s->games,
+                (unsigned long long)s->ticks);
+        fprintf(out, "\"score\": {\"mean\": %.3f, \"stddev\": %.3f, \"min\": %d, \"p10\": %d, \"p50\": %d, \"p90\": %d, \"p99\": %d, \"max\": %d}, ",
+                mean, sqrt(variance > 0 ? variance : 0), histogram_min(&s->scores),
+                histogram_percentile(&s->scores, s->games, 0.10), histogram_percentile(&s->scores, s->games, 0.50),
+                histogram_percentile(&s->scores, s->games, 0.90), histogram_percentile(&s->scores, s->games, 0.99),
+                histogram_max(&s->scores));
+        fprintf(out, "\"length\": {\"mean\": %.3f, \"p50\": %d, \"max\": %d}, ",
+                histogram_mean(&s->lengths, s->games), histogram_percentile(&s->lengths, s->games, 0.50), histogram_max(&s->lengths));
+        fprintf(out, "\"ends\": {\"border\": %ld, \"self\": %ld, \"poison\": %ld, \"board_full\": %ld, \"timeout\": %ld}, ",
+                s->ends[END_BORDER], s->ends[END_SELF], s->ends[END_POISON], s->ends[END_BOARD_FULL], s->ends[END_TIMEOUT]);
+        write_histogram_json(out, "score_histogram", &s->scores);
+        fprintf(out, ", ");
+        write_histogram_json(out, "length_histogram", &s->lengths);
+        fprintf(out, "}");
+    }
+    fprintf(out, "\n]}\n");
+}
+
+int main(int argc, char *argv[]) {
+    static Tournament tournament;
+    static Worker workers[MAX_THREADS];
+    static EntryStats totals[MAX_ENTRIES];
+    char agentList[256] = "bfs", rulesList[256] = "classic";
+    const char *format = "csv", *outputPath = NULL, *scoresPath = NULL;
+    int threads = SDL_GetCPUCount();
+    tournament.gamesPerEntry = 1000;
+    tournament.width = 35;
+    tournament.height = 30;
+    tournament.seed = 1;
+    tournament.maxTicks = 100000;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--agents") == 0 && i + 1 < argc) {
+            snprintf(agentList, sizeof(agentList), "%s", argv[++i]);
+        } else if (strcmp(argv[i], "--rules") == 0 && i + 1 < argc) {
+            snprintf(rulesList, sizeof(rulesList), "%s", argv[++i]);
+        } else if (strcmp(argv[i], "--games") == 0 && i + 1 < argc) {
+            tournament.gamesPerEntry = atol(argv[++i]);
+        } else if (strcmp(argv[i], "--board") == 0 && i + 1 < argc) {
+            sscanf(argv[++i], "%dx%d", &tournament.width, &tournament.height);
+        } else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+            tournament.seed = (uint32_t)strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            threads = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--max-ticks") == 0 && i + 1 < argc) {
+            tournament.maxTicks = atol(argv[++i]);
+        } else if (strcmp(argv[i], "--format") == 0 && i + 1 < argc) {
+            format = argv[++i];
+        } else if (strcmp(argv[i], "--output") == 0 && i + 1 < argc) {
+            outputPath = argv[++i];
+        } else if (strcmp(argv[i], "--scores") == 0 && i + 1 < argc) {
+            scoresPath = argv[++i];
+        } else {
+            printf("Unknown option: %s\n", argv[i]);
+            return 1;
+        }
+    }
+    if (threads < 1) threads = 1;
+    if (threads > MAX_THREADS) threads = MAX_THREADS;
+    if (tournament.gamesPerEntry < 1 || (strcmp(format, "csv") != 0 && strcmp(format, "json") != 0)) {
+        printf("Need at least one game and a csv or json format\n");
+        return 1;
+    }
+
+    // Every agent plays under every rule variant
+    char *agentSave = NULL;
+    for (char *agentName = SDL_strtokr(agentList, ",", &agentSave); agentName; agentName = SDL_strtokr(NULL, ",", &agentSave)) {
+        char rulesCopy[256];
+        snprintf(rulesCopy, sizeof(rulesCopy), "%s", rulesList);
+        char *rulesSave = NULL;
+        for (char *rulesName = SDL_strtokr(rulesCopy, ",", &rulesSave); rulesName; rulesName = SDL_strtokr(NULL, ",", &rulesSave)) {
+            if (tournament.entryCount == MAX_ENTRIES) {
+                printf("At most %d agent and rules combinations\n", MAX_ENTRIES);
+                return 1;
+            }
+            Entry *entry = &tournament.entries[tournament.entryCount++];
+            snprintf(entry->agentName, sizeof(entry->agentName), "%s", agentName);
+            snprintf(entry->rulesName, sizeof(entry->rulesName), "%s", rulesName);
+            if (find_rules(rulesName, &entry->rules) < 0) {
+                printf("Unknown rules: %s\n", rulesName);
+                return 1;
+            }
+        }
+    }
+    // Each worker's last claim still adds GAMES_PER_CLAIM to the shared int counter
+    if ((double)tournament.gamesPerEntry * tournament.entryCount > (double)INT_MAX - (double)threads * GAMES_PER_CLAIM) {
+        printf("Too many games for one run\n");
+        return 1;
+    }
+    // Check every agent once up front rather than failing inside the workers
+    for (int e = 0; e < tournament.entryCount; e++) {
+        Agent agent;
+        if (create_agent(&agent, tournament.entries[e].agentName, tournament.width, tournament.height) < 0) {
+            printf("Unknown agent or unsupported board: %s\n", tournament.entries[e].agentName);
+            return 1;
+        }
+        destroy_agent(&agent);
+    }
+
+    ScoreLog scores;
+    if (scoresPath) {
+        if (open_score_log(&scores, scoresPath, 1000, 4096) < 0 || !(tournament.scoresLock = SDL_CreateMutex())) {
+            printf("Cannot open score log %s\n", scoresPath);
+            return 1;
+        }
+        tournament.scores = &scores;
+    }
+
+    if (threads > 1) {
+        tournament.mctsThreads = SDL_GetCPUCount() / threads > 1 ? SDL_GetCPUCount() / threads : 1;
+    }
+    SDL_AtomicSet(&tournament.nextGame, 0);
+    SDL_Thread *handles[MAX_THREADS];
+    Uint64 start = SDL_GetPerformanceCounter();
+    for (int t = 0; t < threads; t++) {
+        workers[t].tournament = &tournament;
+        handles[t] = SDL_CreateThread(worker_main, "tournament", &workers[t]);
+        if (!handles[t]) {
+            printf("Thread creation failed: %s\n", SDL_GetError());
+            return 1;
+        }
+    }
+    int failed = 0;
+    for (int t = 0; t < threads; t++) {
+        SDL_WaitThread(handles[t], NULL);
+        failed |= workers[t].failed;
+    }
+    if (scoresPath) {
+        failed |= sync_score_log(&scores) < 0;
+        close_score_log(&scores);
+        SDL_DestroyMutex(tournament.scoresLock);
+    }
+    double seconds = (double)(SDL_GetPerformanceCounter() - start) / (double)SDL_GetPerformanceFrequency();
+    if (failed) {
+        printf("A worker ran out of memory, could not create its agent or could not write scores\n");
+        return 1;
+    }
+
+    // Per-thread statistics are only combined once everything has finished
+    uint64_t ticks = 0;
+    long games = 0;
+    for (int e = 0; e < tournament.entryCount; e++) {
+        for (int t = 0; t < threads; t++) {
+            const EntryStats *s = &workers[t].stats[e];
+            totals[e].games += s->games;
+            totals[e].ticks += s->ticks;
+            totals[e].seconds += s->seconds;
+            totals[e].scoreSum += s->scoreSum;
+            totals[e].scoreSquares += s->scoreSquares;
+            for (int r = 0; r <= END_BOARD_FULL; r++) totals[e].ends[r] += s->ends[r];
+            if (histogram_merge(&totals[e].scores, &s->scores) < 0 || histogram_merge(&totals[e].lengths, &s->lengths) < 0) {
+                printf("Out of memory\n");
+                return 1;
+            }
+        }
+        ticks += totals[e].ticks;
+        games += totals[e].games;
+    }
+
+    FILE *out = outputPath ? fopen(outputPath, "w") : stdout;
+    if (!out) {
+        printf("Cannot open %s for writing\n", outputPath);
+        return 1;
+    }
+    if (strcmp(format, "json") == 0) {
+        write_json(out, &tournament, totals, threads, seconds);
+    } else {
+        write_csv(out, &tournament, totals);
+    }
+    if (out != stdout) fclose(out);
+    fprintf(stderr, "%ld games, %llu steps in %.3f s on %d threads: %.0f games/s, %.0f steps/s\n",
+            games, (unsigned long long)ticks, seconds, threads, games / seconds, ticks / seconds);
+    return 0;
+}
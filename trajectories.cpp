@@ -0,0 +1,248 @@
+#include <SDL2/SDL.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "snake_engine.h"
+#include "agent.h"
+#include "distance_field.h"
+#include "observation.h"
+#include "replay.h"
+#include "replay_corpus.h"
+#include "trajectory_dataset.h"
+
+// Exports (observation, action, reward, done) columns for offline RL, see
+// trajectory_dataset.h. Episodes come from an agent playing consecutive
+// seeds or from a replay corpus, one shard per thread.
+// Usage: trajectories --out base [--agent bfs] [--games N] [--seed S] [--board WxH]
+//                     [--rules classic] [--max-ticks N] [--threads T] [--chunk-rows N]
+//        trajectories --out base --corpus file.snc [--threads T] [--chunk-rows N]
+//        trajectories --read base      sums rewards from the mapped reward and done columns
+
+#define MAX_THREADS 256
+#define GAMES_PER_CLAIM 4
+
+typedef struct {
+    const char *agentName;
+    GameRules rules;
+    int width, height;
+    uint32_t seed;
+    long games;
+    long maxTicks;
+    ReplayCorpus *corpus;   // replays instead of an agent when set
+    SDL_atomic_t nextGame;
+} Export;
+
+typedef struct {
+    Export *job;
+    TrajectoryShard shard;
+    long skipped;           // replays for another board or rules version
+    int failed;
+} Worker;
+
+// Plays one episode into the shard; replay is NULL when the agent decides
+static void play_episode(TrajectoryShard *shard, GameState *game, Agent *agent, const ReplayReader *replay, uint32_t seed, long maxTicks) {
+    begin_trajectory_episode(shard, seed);
+    long ticks = replay ? (long)replay->header.ticks : maxTicks;
+    while (!game->isGameOver && (long)game->tick < ticks) {
+        encode_observation(game, next_trajectory_observation(shard));
+        int direction = replay ? replay_action(replay->actions, game->tick) : agent_decide(agent, game);
+        steer_snake(&game->snake, direction_movement(direction));
+        int action = movement_direction(game->snake.movement);//the heading taken, a reversal is ignored
+        int score = game->score;
+        step_game(game);
+        int done = game->isGameOver ? TRAJECTORY_TERMINAL : (long)game->tick >= ticks ? TRAJECTORY_TRUNCATED : TRAJECTORY_RUNNING;
+        commit_transition(shard, action, (float)(game->score - score), done);
+    }
+    end_trajectory_episode(shard, game);
+}
+
+static int worker_main(void *data) {
+    Worker *worker = (Worker *)data;
+    Export *job = worker->job;
+    GameState game;
+    DistanceField foodDistance;
+    Agent agent = {};
+    if (create_game(&game, job->width, job->height, 1) < 0) {
+        worker->failed = 1;
+        return 1;
+    }
+    if (create_distance_field(&foodDistance, job->width, job->height) < 0 || (!job->corpus && create_agent(&agent, job->agentName, job->width, job->height) < 0)) {
+        destroy_game(&game);
+        worker->failed = 1;
+        return 1;
+    }
+    game.distanceField = &foodDistance;//fills the food distance plane
+    for (;;) {
+        long first = SDL_AtomicAdd(&job->nextGame, GAMES_PER_CLAIM);
+        if (first >= job->games) break;
+        long last = first + GAMES_PER_CLAIM < job->games ? first + GAMES_PER_CLAIM : job->games;
+        for (long i = first; i < last; i++) {
+            ReplayReader replay;
+            if (job->corpus) {
+                prefetch_corpus_replay(job->corpus, (uint64_t)last);
+                if (corpus_replay(job->corpus, (uint64_t)i, &replay) < 0 || replay.header.rulesVersion != RULES_VERSION
+                    || replay.header.width != job->width || replay.header.height != job->height) {
+                    worker->skipped++;
+                    continue;
+                }
+                game.rules = replay.header.rules;
+                game.rng = replay.header.seed;
+                initialize_game(&game);
+                play_episode(&worker->shard, &game, NULL, &replay, replay.header.seed, 0);
+            } else {
+                uint32_t seed = job->seed + (uint32_t)i;
+                game.rules = job->rules;
+                game.rng = seed ? seed : 0x9e3779b9u;
+                initialize_game(&game);
+                play_episode(&worker->shard, &game, &agent, NULL, seed, job->maxTicks);
+            }
+        }
+        if (worker->shard.failed) break;
+    }
+    if (!job->corpus) destroy_agent(&agent);
+    destroy_distance_field(&foodDistance);
+    destroy_game(&game);
+    return 0;
+}
+
+// Touches only the small columns, the observations are never mapped
+static int read_dataset(const char *base) {
+    TrajectoryDataset dataset;
+    if (open_trajectory_dataset(&dataset, base) < 0) {
+        printf("Cannot open dataset %s\n", base);
+        return 1;
+    }
+    Uint64 start = SDL_GetPerformanceCounter();
+    double rewardSum = 0;
+    uint64_t terminals = 0, rows = 0;
+    for (int s = 0; s < dataset.shardCount; s++) {
+        uint64_t shardRows;
+        const float *rewards = (const float *)trajectory_column(&dataset, s, COLUMN_REWARD, &shardRows);
+        const unsigned char *done = (const unsigned char *)trajectory_column(&dataset, s, COLUMN_DONE, &shardRows);
+        if (!rewards || !done) continue;
+        for (uint64_t r = 0; r < shardRows; r++) {
+            rewardSum += rewards[r];
+            terminals += done[r] == TRAJECTORY_TERMINAL;
+        }
+        rows += shardRows;
+    }
+    double seconds = (double)(SDL_GetPerformanceCounter() - start) / (double)SDL_GetPerformanceFrequency();
+    printf("%dx%d board, %d shards, %llu episodes, %llu of %llu rows read, %llu terminal, mean return %.2f, %.0f rows/s\n",
+           dataset.width, dataset.height, dataset.shardCount, (unsigned long long)dataset.episodeCount, (unsigned long long)rows,
+           (unsigned long long)dataset.rows, (unsigned long long)terminals, dataset.episodeCount ? rewardSum / dataset.episodeCount : 0.0,
+           rows / seconds);
+    close_trajectory_dataset(&dataset);
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+    static Worker workers[MAX_THREADS];
+    Export job = {};
+    ReplayCorpus corpus;
+    const char *outputBase = NULL, *corpusPath = NULL;
+    int threads = SDL_GetCPUCount(), chunkRows = 1024;
+    job.agentName = "bfs";
+    job.rules = classic_rules();
+    job.width = 35;
+    job.height = 30;
+    job.seed = 1;
+    job.games = 1000;
+    job.maxTicks = 100000;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--read") == 0 && i + 1 < argc) {
+            return read_dataset(argv[++i]);
+        } else if (strcmp(argv[i], "--out") == 0 && i + 1 < argc) {
+            outputBase = argv[++i];
+        } else if (strcmp(argv[i], "--agent") == 0 && i + 1 < argc) {
+            job.agentName = argv[++i];
+        } else if (strcmp(argv[i], "--games") == 0 && i + 1 < argc) {
+            job.games = atol(argv[++i]);
+        } else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+            job.seed = (uint32_t)strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--board") == 0 && i + 1 < argc) {
+            sscanf(argv[++i], "%dx%d", &job.width, &job.height);
+        } else if (strcmp(argv[i], "--rules") == 0 && i + 1 < argc) {
+            if (find_rules(argv[++i], &job.rules) < 0) {
+                printf("Unknown rules: %s\n", argv[i]);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--max-ticks") == 0 && i + 1 < argc) {
+            job.maxTicks = atol(argv[++i]);
+        } else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            threads = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--chunk-rows") == 0 && i + 1 < argc) {
+            chunkRows = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--corpus") == 0 && i + 1 < argc) {
+            corpusPath = argv[++i];
+        } else {
+            printf("Unknown option: %s\n", argv[i]);
+            return 1;
+        }
+    }
+    if (!outputBase) {
+        printf("Usage: %s --out base [--agent name | --corpus file.snc] [options], or --read base\n", argv[0]);
+        return 1;
+    }
+    if (threads < 1) threads = 1;
+    if (threads > MAX_THREADS) threads = MAX_THREADS;
+    if (corpusPath) {//the first replay decides the board, others must match it
+        char indexPath[1024];
+        snprintf(indexPath, sizeof(indexPath), "%s.idx", corpusPath);
+        ReplayReader first;
+        if (open_replay_corpus(&corpus, corpusPath, indexPath) < 0 || corpus_replay(&corpus, 0, &first) < 0) {
+            printf("Cannot open a non-empty corpus %s\n", corpusPath);
+            return 1;
+        }
+        job.corpus = &corpus;
+        job.games = (long)corpus.count;
+        job.width = first.header.width;
+        job.height = first.header.height;
+    } else {
+        Agent agent;
+        if (create_agent(&agent, job.agentName, job.width, job.height) < 0) {
+            printf("Unknown agent or unsupported board: %s\n", job.agentName);
+            return 1;
+        }
+        destroy_agent(&agent);
+    }
+
+    SDL_AtomicSet(&job.nextGame, 0);
+    SDL_Thread *handles[MAX_THREADS];
+    Uint64 start = SDL_GetPerformanceCounter();
+    for (int t = 0; t < threads; t++) {
+        workers[t].job = &job;
+        if (open_trajectory_shard(&workers[t].shard, outputBase, t, job.width, job.height, chunkRows) < 0) {
+            printf("Cannot create the columns of shard %d\n", t);
+            return 1;
+        }
+        handles[t] = SDL_CreateThread(worker_main, "trajectories", &workers[t]);
+        if (!handles[t]) {
+            printf("Thread creation failed: %s\n", SDL_GetError());
+            return 1;
+        }
+    }
+    int failed = 0;
+    long skipped = 0;
+    TrajectoryShard shards[MAX_THREADS];
+    for (int t = 0; t < threads; t++) {
+        SDL_WaitThread(handles[t], NULL);
+        failed |= workers[t].failed | (close_trajectory_shard(&workers[t].shard) < 0);
+        skipped += workers[t].skipped;
+        shards[t] = workers[t].shard;
+    }
+    uint64_t rows = 0, episodes = 0;
+    for (int t = 0; t < threads; t++) {
+        rows += shards[t].rows;
+        episodes += shards[t].episodeCount;
+    }
+    failed |= write_trajectory_index(outputBase, shards, threads, job.width, job.height) < 0;
+    double seconds = (double)(SDL_GetPerformanceCounter() - start) / (double)SDL_GetPerformanceFrequency();
+    if (job.corpus) close_replay_corpus(&corpus);
+    if (failed) {
+        printf("Writing %s failed\n", outputBase);
+        return 1;
+    }
+    printf("%llu episodes, %llu transitions, %ld replays skipped, in %.3f s on %d threads: %.0f transitions/s\n",
+           (unsigned long long)episodes, (unsigned long long)rows, skipped, seconds, threads, rows / seconds);
+    return 0;
+}
@@ -0,0 +1,213 @@
+#include "trajectory_dataset.h"
+#include "observation.h"
+#include "byte_order.h"
+#include <stdlib.h>
+#include <string.h>
+
+static const char *columnExtensions[TRAJECTORY_COLUMNS] = {"obs", "action", "reward", "done"};
+
+static void column_path(char *path, size_t size, const char *base, int shard, int column) {
+    snprintf(path, size, "%s-%d.%s", base, shard, columnExtensions[column]);
+}
+
+int open_trajectory_shard(TrajectoryShard *shard, const char *base, int index, int width, int height, int chunkRows) {
+    memset(shard, 0, sizeof(*shard));
+    shard->shard = index;
+    shard->chunkRows = chunkRows > 0 ? chunkRows : 1024;
+    shard->rowBytes[COLUMN_OBSERVATION] = (int)sizeof(float) * observation_size(width, height);
+    shard->rowBytes[COLUMN_ACTION] = 1;
+    shard->rowBytes[COLUMN_REWARD] = (int)sizeof(float);
+    shard->rowBytes[COLUMN_DONE] = 1;
+    for (int c = 0; c < TRAJECTORY_COLUMNS; c++) {
+        char path[512];
+        column_path(path, sizeof(path), base, index, c);
+        shard->columns[c] = fopen(path, "wb");
+        shard->chunks[c] = (unsigned char *)malloc((size_t)shard->rowBytes[c] * shard->chunkRows);
+        if (!shard->columns[c] || !shard->chunks[c]) {
+            close_trajectory_shard(shard);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+static int flush_chunk(TrajectoryShard *shard) {
+    for (int c = 0; c < TRAJECTORY_COLUMNS && shard->bufferedRows; c++) {
+        if (fwrite(shard->chunks[c], shard->rowBytes[c], shard->bufferedRows, shard->columns[c]) != (size_t)shard->bufferedRows) {
+            shard->failed = 1;
+        }
+    }
+    shard->bufferedRows = 0;
+    return shard->failed ? -1 : 0;
+}
+
+void begin_trajectory_episode(TrajectoryShard *shard, uint32_t seed) {
+    shard->episodeStart = shard->rows;
+    shard->episodeSeed = seed;
+}
+
+// Where the observation of the next transition goes, encode_observation() it
+// there before the step and commit_transition() after
+float *next_trajectory_observation(TrajectoryShard *shard) {
+    return (float *)(shard->chunks[COLUMN_OBSERVATION] + (size_t)shard->bufferedRows * shard->rowBytes[COLUMN_OBSERVATION]);
+}
+
+int commit_transition(TrajectoryShard *shard, int action, float reward, int done) {
+    int row = shard->bufferedRows;
+    shard->chunks[COLUMN_ACTION][row] = (unsigned char)action;
+    memcpy(shard->chunks[COLUMN_REWARD] + (size_t)row * sizeof(float), &reward, sizeof(float));
+    shard->chunks[COLUMN_DONE][row] = (unsigned char)done;
+    shard->rows++;
+    if (++shard->bufferedRows == shard->chunkRows) {
+        return flush_chunk(shard);
+    }
+    return 0;
+}
+
+int end_trajectory_episode(TrajectoryShard *shard, const GameState *game) {
+    if (shard->episodeCount == shard->episodeCapacity) {
+        size_t capacity = shard->episodeCapacity ? shard->episodeCapacity * 2 : 256;
+        unsigned char *episodes = (unsigned char *)realloc(shard->episodes, capacity * TRAJECTORY_EPISODE_SIZE);
+        if (!episodes) {
+            shard->failed = 1;
+            return -1;
+        }
+        shard->episodes = episodes;
+        shard->episodeCapacity = capacity;
+    }
+    unsigned char *entry = shard->episodes + shard->episodeCount++ * TRAJECTORY_EPISODE_SIZE;
+    put_u32(entry, (uint32_t)shard->shard);
+    put_u32(entry + 4, shard->episodeSeed);
+    put_u64(entry + 8, shard->episodeStart);
+    put_u32(entry + 16, (uint32_t)(shard->rows - shard->episodeStart));
+    put_u32(entry + 20, (uint32_t)game->score);
+    put_u32(entry + 24, (uint32_t)game->endReason);
+    put_u32(entry + 28, 0);
+    return 0;
+}
+
+// Writes out the last partial chunk; the episode table is kept for the index
+int close_trajectory_shard(TrajectoryShard *shard) {
+    if (shard->chunks[0]) flush_chunk(shard);
+    for (int c = 0; c < TRAJECTORY_COLUMNS; c++) {
+        if (shard->columns[c] && fclose(shard->columns[c]) != 0) shard->failed = 1;
+        free(shard->chunks[c]);
+        shard->columns[c] = NULL;
+        shard->chunks[c] = NULL;
+    }
+    return shard->failed ? -1 : 0;
+}
+
+// Frees every shard's episode table once written
+int write_trajectory_index(const char *base, TrajectoryShard *shards, int shardCount, int width, int height) {
+    char path[512];
+    snprintf(path, sizeof(path), "%s.tdx", base);
+    FILE *file = fopen(path, "wb");
+    uint64_t rows = 0, episodes = 0;
+    for (int s = 0; s < shardCount; s++) {
+        rows += shards[s].rows;
+        episodes += shards[s].episodeCount;
+    }
+    unsigned char header[TRAJECTORY_HEADER_SIZE];
+    memcpy(header, "SNTD", 4);
+    put_u32(header + 4, TRAJECTORY_VERSION);
+    put_u32(header + 8, OBSERVATION_CHANNELS);
+    put_u32(header + 12, (uint32_t)width);
+    put_u32(header + 16, (uint32_t)height);
+    put_u32(header + 20, (uint32_t)shards[0].chunkRows);
+    put_u32(header + 24, (uint32_t)shardCount);
+    put_u64(header + 28, rows);
+    put_u64(header + 36, episodes);
+    int ok = file && fwrite(header, 1, sizeof(header), file) == sizeof(header);
+    for (int s = 0; ok && s < shardCount; s++) {
+        unsigned char shardRows[8];
+        put_u64(shardRows, shards[s].rows);
+        ok = fwrite(shardRows, 1, 8, file) == 8;
+    }
+    for (int s = 0; s < shardCount; s++) {
+        ok = ok && fwrite(shards[s].episodes, TRAJECTORY_EPISODE_SIZE, shards[s].episodeCount, file) == shards[s].episodeCount;
+        free(shards[s].episodes);
+        shards[s].episodes = NULL;
+    }
+    if (file) ok = fclose(file) == 0 && ok;
+    return ok ? 0 : -1;
+}
+
+int open_trajectory_dataset(TrajectoryDataset *dataset, const char *base) {
+    memset(dataset, 0, sizeof(*dataset));
+    snprintf(dataset->base, sizeof(dataset->base), "%s", base);
+    char path[512];
+    snprintf(path, sizeof(path), "%s.tdx", base);
+    if (map_file(&dataset->index, path) < 0) {
+        return -1;
+    }
+    const unsigned char *header = dataset->index.data;
+    int ok = dataset->index.size >= TRAJECTORY_HEADER_SIZE && memcmp(header, "SNTD", 4) == 0
+          && get_u32(header + 4) == TRAJECTORY_VERSION;
+    if (ok) {
+        dataset->channels = (int)get_u32(header + 8);
+        dataset->width = (int)get_u32(header + 12);
+        dataset->height = (int)get_u32(header + 16);
+        dataset->chunkRows = (int)get_u32(header + 20);
+        dataset->shardCount = (int)get_u32(header + 24);
+        dataset->rows = get_u64(header + 28);
+        dataset->episodeCount = get_u64(header + 36);
+        size_t tables = (size_t)dataset->shardCount * 8;
+        ok = dataset->shardCount > 0 && dataset->channels == OBSERVATION_CHANNELS
+          && dataset->index.size >= TRAJECTORY_HEADER_SIZE + tables
+          && (dataset->index.size - TRAJECTORY_HEADER_SIZE - tables) / TRAJECTORY_EPISODE_SIZE >= dataset->episodeCount;
+        dataset->episodes = header + TRAJECTORY_HEADER_SIZE + tables;
+    }
+    if (ok) {
+        dataset->columns = (MappedFile *)calloc((size_t)dataset->shardCount * TRAJECTORY_COLUMNS, sizeof(MappedFile));
+        ok = dataset->columns != NULL;
+    }
+    if (!ok) {
+        close_trajectory_dataset(dataset);
+        return -1;
+    }
+    return 0;
+}
+
+void close_trajectory_dataset(TrajectoryDataset *dataset) {
+    for (int i = 0; dataset->columns && i < dataset->shardCount * TRAJECTORY_COLUMNS; i++) {
+        unmap_file(&dataset->columns[i]);
+    }
+    free(dataset->columns);
+    dataset->columns = NULL;
+    unmap_file(&dataset->index);
+}
+
+// Maps one column of one shard the first time it is asked for; rows gets the
+// shard's row count. NULL for an empty shard, or when the file is missing or
+// shorter than the index says.
+const void *trajectory_column(TrajectoryDataset *dataset, int shard, int column, uint64_t *rows) {
+    static const int rowBytes[TRAJECTORY_COLUMNS] = {0, 1, sizeof(float), 1};
+    if (shard < 0 || shard >= dataset->shardCount || column < 0 || column >= TRAJECTORY_COLUMNS) {
+        return NULL;
+    }
+    *rows = get_u64(dataset->index.data + TRAJECTORY_HEADER_SIZE + (size_t)shard * 8);
+    MappedFile *mapped = &dataset->columns[shard * TRAJECTORY_COLUMNS + column];
+    if (!mapped->data) {
+        char path[512];
+        column_path(path, sizeof(path), dataset->base, shard, column);
+        if (map_file(mapped, path) < 0) {
+            return NULL;
+        }
+    }
+    size_t bytes = column == COLUMN_OBSERVATION ? sizeof(float) * observation_size(dataset->width, dataset->height) : rowBytes[column];
+    if (mapped->size / bytes < *rows) {
+        return NULL;
+    }
+    return mapped->data;
+}
+
+void trajectory_episode(const TrajectoryDataset *dataset, uint64_t n, TrajectoryEpisode *episode) {
+    const unsigned char *entry = dataset->episodes + n * TRAJECTORY_EPISODE_SIZE;
+    episode->shard = (int)get_u32(entry);
+    episode->seed = get_u32(entry + 4);
+    episode->firstRow = get_u64(entry + 8);
+    episode->length = get_u32(entry + 16);
+    episode->score = (int)get_u32(entry + 20);
+    episode->endReason = (int)get_u32(entry + 24);
+}
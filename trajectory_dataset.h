@@ -0,0 +1,74 @@
+#ifndef TRAJECTORY_DATASET_H
+#define TRAJECTORY_DATASET_H
+
+#include <stdio.h>
+#include "snake_engine.h"
+#include "replay_corpus.h"
+
+// (observation, action, reward, done) transitions for offline RL, stored by
+// column. Every generator thread writes its own shard, one file per column:
+//   <base>-<shard>.obs     float32 rows of observation_size() (observation.h)
+//   <base>-<shard>.action  u8 heading taken, 0..3 as direction_movement()
+//   <base>-<shard>.reward  float32 score change over the step
+//   <base>-<shard>.done    u8 TRAJECTORY_* below
+// Row r of every column of a shard is the same transition, so a reader maps
+// only the columns it needs and slices rows by pointer arithmetic. Columns
+// are written chunkRows rows at a time. Episodes are contiguous in a shard.
+//
+// <base>.tdx index, little-endian: "SNTD" | u32 version | u32 channels,
+//   width, height | u32 chunk rows | u32 shard count | u64 rows | u64 episodes
+//   then u64 rows per shard, then per episode: u32 shard | u32 seed |
+//   u64 first row | u32 length | i32 score | u32 end reason | u32 reserved
+// Floats are IEEE little-endian, as on every platform the game builds for.
+
+#define TRAJECTORY_VERSION 2   // 2 added the poison plane
+#define TRAJECTORY_HEADER_SIZE 44
+#define TRAJECTORY_EPISODE_SIZE 32
+
+enum { TRAJECTORY_RUNNING, TRAJECTORY_TERMINAL, TRAJECTORY_TRUNCATED };
+enum { COLUMN_OBSERVATION, COLUMN_ACTION, COLUMN_REWARD, COLUMN_DONE, TRAJECTORY_COLUMNS };
+
+typedef struct {
+    FILE *columns[TRAJECTORY_COLUMNS];
+    unsigned char *chunks[TRAJECTORY_COLUMNS];  // chunkRows rows of each column
+    int rowBytes[TRAJECTORY_COLUMNS];
+    int chunkRows, bufferedRows;
+    uint64_t rows;                  // committed, written or buffered
+    unsigned char *episodes;        // index entries, shard and first row filled in
+    size_t episodeCount, episodeCapacity;
+    uint64_t episodeStart;
+    uint32_t episodeSeed;
+    int shard, failed;
+} TrajectoryShard;
+
+typedef struct {
+    MappedFile index;
+    int channels, width, height, chunkRows, shardCount;
+    uint64_t rows, episodeCount;
+    const unsigned char *episodes;
+    char base[480];
+    MappedFile *columns;            // shardCount * TRAJECTORY_COLUMNS, mapped on first use
+} TrajectoryDataset;
+
+typedef struct {
+    int shard;
+    uint32_t seed;
+    uint64_t firstRow;
+    uint32_t length;
+    int score, endReason;
+} TrajectoryEpisode;
+
+int open_trajectory_shard(TrajectoryShard *shard, const char *base, int index, int width, int height, int chunkRows);
+void begin_trajectory_episode(TrajectoryShard *shard, uint32_t seed);
+float *next_trajectory_observation(TrajectoryShard *shard);
+int commit_transition(TrajectoryShard *shard, int action, float reward, int done);
+int end_trajectory_episode(TrajectoryShard *shard, const GameState *game);
+int close_trajectory_shard(TrajectoryShard *shard);
+int write_trajectory_index(const char *base, TrajectoryShard *shards, int shardCount, int width, int height);
+
+int open_trajectory_dataset(TrajectoryDataset *dataset, const char *base);
+void close_trajectory_dataset(TrajectoryDataset *dataset);
+const void *trajectory_column(TrajectoryDataset *dataset, int shard, int column, uint64_t *rows);
+void trajectory_episode(const TrajectoryDataset *dataset, uint64_t n, TrajectoryEpisode *episode);
+
+#endif